@@ -1,6 +1,6 @@
 /*
 	qmk-hid-identify - Identify the current OS to QMK device
-	Copyright 2021  Simon Arlott
+	Copyright 2021,2026  Simon Arlott
 
 	This program is free software: you can redistribute it and/or modify
 	it under the terms of the GNU General Public License as published by
@@ -17,6 +17,12 @@
 */
 #include "hid-device.h"
 
+#include <time.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <string>
 
@@ -25,82 +31,172 @@
 
 namespace hid_identify {
 
-static constexpr uint32_t RAW_USAGE_PAGE = 0xFF60;
-static constexpr uint32_t RAW_USAGE_ID = 0x0061;
-static constexpr uint32_t RAW_IN_USAGE_ID = 0x0062;
-static constexpr uint32_t RAW_OUT_USAGE_ID = 0x0063;
+Rejection HIDDevice::open() {
+	Rejection rejection;
+
+	HID_TRY {
+		rejection = open(device_info_, reports_);
+	} HID_CATCH(...) {
+		close();
+		HID_RETHROW;
+	}
 
-void HIDDevice::open() {
-	try {
-		open(device_info_, reports_);
-	} catch (...) {
+	if (rejection != Rejection::NONE) {
 		close();
-		throw;
 	}
+
+	return rejection;
 }
 
-void HIDDevice::identify() {
-	open(device_info_, reports_);
-	check_device_allowed();
-	check_device_reports();
-	send_report();
+Rejection HIDDevice::identify() {
+	Rejection rejection = prepare_identify();
+	if (rejection != Rejection::NONE) {
+		return rejection;
+	}
+
+	send_report(report_.data(), report_length_);
+	end_stage(Stage::WRITE);
+	report_sent();
+	return Rejection::NONE;
+}
+
+Rejection HIDDevice::prepare_identify() {
+	begin_stages();
+
+	bool probed = probe(device_info_);
+	Rejection rejection;
+
+	end_stage(Stage::PROBE);
+
+	if (probed) {
+		rejection = check_device_allowed();
+		end_stage(Stage::CHECK_ALLOWED);
+		if (rejection != Rejection::NONE) {
+			return rejection;
+		}
+	}
+
+	/* The device can end some of the later stages while it's being opened */
+	rejection = open(device_info_, reports_);
+	end_stage(Stage::OPEN);
+	if (rejection != Rejection::NONE) {
+		return rejection;
+	}
+
+	if (!probed) {
+		rejection = check_device_allowed();
+		end_stage(Stage::CHECK_ALLOWED);
+		if (rejection != Rejection::NONE) {
+			return rejection;
+		}
+	}
+
+	rejection = check_device_reports();
+	end_stage(Stage::CHECK_REPORTS);
+	if (rejection != Rejection::NONE) {
+		return rejection;
+	}
+
+	prepare_report();
+	return Rejection::NONE;
 }
 
 void HIDDevice::close() noexcept {
 	device_info_ = {};
 	reports_.clear();
 	report_count_ = 0;
+	report_length_ = 0;
 	reset();
 }
 
+bool HIDDevice::probe(USBDeviceInfo &device_info __attribute__((unused))) {
+	return false;
+}
+
 void HIDDevice::reset() noexcept {
 }
 
-void HIDDevice::check_device_allowed() {
-	if (device_info_.interface_number == -1 || device_info_.interface_number == 1) {
-		if (usb_device_allowed(device_info_.vendor, device_info_.product)) {
-			return;
-		}
+bool HIDDevice::device_allowed(const USBDeviceInfo &device_info) {
+	return (device_info.interface_number == -1 || device_info.interface_number == 1)
+		&& usb_device_allowed(device_info.vendor, device_info.product);
+}
+
+Rejection HIDDevice::check_device_allowed() {
+	if (device_allowed(device_info_)) {
+		return Rejection::NONE;
 	}
 
 	log(LogLevel::INFO, LogCategory::UNSUPPORTED_DEVICE, LogMessage::DEV_NOT_ALLOWED,
-		0, ::gettext("Device not allowed"));
-	throw DisallowedUSBDevice{};
-}
-
-void HIDDevice::check_device_reports() {
-	for (auto& report : reports_) {
-		if (report.usage_page == RAW_USAGE_PAGE
-				&& report.usage == RAW_USAGE_ID
-				&& report.in.size() == 1
-				&& report.out.size() == 1
-				&& report.feature.empty()) {
-			auto &in = report.in.front();
-			auto &out = report.out.front();
-
-			if (in.has_usage && in.usage == RAW_IN_USAGE_ID
-					&& in.has_minimum && in.minimum == 0
-					&& in.has_maximum && in.maximum == UINT8_MAX
-					&& in.has_size && in.size == 8 /* bits */
-					&& in.has_count && in.count > 0
-					&& out.has_usage && out.usage == RAW_OUT_USAGE_ID
-					&& out.has_minimum && out.minimum == 0
-					&& out.has_maximum && out.maximum == UINT8_MAX
-					&& out.has_size && out.size == 8 /* bits */
-					&& out.has_count && out.count > 0) {
-				report_count_ = out.count;
-				return;
-			}
+		LOG_FORMAT("Device not allowed"));
+	return Rejection::DISALLOWED_USB_DEVICE;
+}
+
+uint32_t HIDDevice::raw_report_count(const HIDReports &reports) {
+	for (size_t i = 0; i < reports.size(); i++) {
+		uint32_t report_count = raw_report_count(reports, i);
+
+		if (report_count > 0) {
+			return report_count;
+		}
+	}
+
+	return 0;
+}
+
+uint32_t HIDDevice::raw_report_count(const HIDReports &reports, size_t report) {
+	if (reports.usage_page(report) == RAW_USAGE_PAGE
+			&& reports.usage(report) == RAW_USAGE_ID
+			&& reports.items(report, HIDReportType::INPUT) == 1
+			&& reports.items(report, HIDReportType::OUTPUT) == 1
+			&& reports.items(report, HIDReportType::FEATURE) == 0) {
+		auto in = reports.item(report, HIDReportType::INPUT, 0);
+		auto out = reports.item(report, HIDReportType::OUTPUT, 0);
+
+		if (in.flags == HIDCollection::HAS_ALL
+				&& in.usage == RAW_IN_USAGE_ID
+				&& in.minimum == 0
+				&& in.maximum == UINT8_MAX
+				&& in.size == 8 /* bits */
+				&& in.count > 0
+				&& out.flags == HIDCollection::HAS_ALL
+				&& out.usage == RAW_OUT_USAGE_ID
+				&& out.minimum == 0
+				&& out.maximum == UINT8_MAX
+				&& out.size == 8 /* bits */
+				&& out.count > 0) {
+			return out.count;
 		}
 	}
 
+	return 0;
+}
+
+void HIDDevice::add_raw_report(HIDReports &reports, uint32_t report_count) {
+	reports.add_report();
+	reports.set_usage(RAW_USAGE_PAGE, RAW_USAGE_ID);
+	reports.add_item(HIDReportType::INPUT, { HIDCollection::HAS_ALL, RAW_IN_USAGE_ID, 0, UINT8_MAX, report_count, 8 });
+	reports.add_item(HIDReportType::OUTPUT, { HIDCollection::HAS_ALL, RAW_OUT_USAGE_ID, 0, UINT8_MAX, report_count, 8 });
+}
+
+Rejection HIDDevice::check_device_reports() {
+	if (reports_.overflow()) {
+		log(LogLevel::WARNING, LogCategory::UNSUPPORTED_DEVICE, LogMessage::DEV_TOO_MANY_REPORTS,
+			LOG_FORMAT("Too many reports in report descriptor"));
+		return Rejection::UNSUPPORTED_HID_REPORT_DESCRIPTOR;
+	}
+
+	report_count_ = raw_report_count(reports_);
+	if (report_count_ > 0) {
+		return Rejection::NONE;
+	}
+
 	log(LogLevel::INFO, LogCategory::UNSUPPORTED_DEVICE, LogMessage::DEV_UNKNOWN_USAGE,
-		0, ::gettext("Not a QMK raw HID device interface"));
-	throw UnsupportedHIDReportUsage{};
+		LOG_FORMAT("Not a QMK raw HID device interface"));
+	return Rejection::UNSUPPORTED_HID_REPORT_USAGE;
 }
 
-void HIDDevice::send_report() {
-	std::vector<uint8_t> data {
+void HIDDevice::prepare_report() {
+	static constexpr std::array<uint8_t, 3> header{
 		/* Report ID */
 		0x00,
 
@@ -110,20 +206,61 @@ void HIDDevice::send_report() {
 
 	/* OS */
 	auto identity = os_identity();
-	data.insert(data.end(), identity.begin(), identity.end());
+	size_t length = header.size() + identity.size();
 
-	if (report_count_ < data.size() - 1) {
+	if (report_count_ < length - 1) {
 		log(LogLevel::ERROR, LogCategory::IO_ERROR, LogMessage::DEV_REPORT_COUNT_TOO_SMALL,
-			2, ::gettext("Report count too small for message (%s < %s)"),
-			std::to_string(report_count_).c_str(), std::to_string(data.size() - 1).c_str());
-		throw IOLengthError{};
+			LOG_FORMAT("Report count too small for message (%s < %s)"),
+			report_count_, length - 1);
+		throw_error(IOLengthError{});
 	}
 
-	data.resize(1 + report_count_);
+	if (report_count_ > report_.size() - 1) {
+		log(LogLevel::ERROR, LogCategory::IO_ERROR, LogMessage::DEV_REPORT_COUNT_TOO_LARGE,
+			LOG_FORMAT("Report count too large (%s > %s)"),
+			report_count_, report_.size() - 1);
+		throw_error(IOLengthError{});
+	}
+
+	report_length_ = 1 + report_count_;
+
+	auto pos = std::copy(header.begin(), header.end(), report_.begin());
+	pos = std::copy(identity.begin(), identity.end(), pos);
+	std::fill(pos, report_.begin() + report_length_, 0);
+}
+
+/*
+ * Stages are measured with the monotonic raw clock where it's available so
+ * that the times aren't affected by NTP adjustments.
+ */
+static uint64_t stage_clock() noexcept {
+#ifdef CLOCK_MONOTONIC_RAW
+	struct timespec ts{};
+
+	::clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+	return static_cast<uint64_t>(ts.tv_sec) * 1000000000U + ts.tv_nsec;
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+void HIDDevice::begin_stages() noexcept {
+	if (stage_times_ != nullptr) {
+		stage_start_ = stage_clock();
+	}
+}
+
+void HIDDevice::record_stage(Stage stage) noexcept {
+	uint64_t now = stage_clock();
+
+	(*stage_times_)[static_cast<size_t>(stage)] += now - stage_start_;
+	stage_start_ = now;
+}
 
-	send_report(data);
+void HIDDevice::report_sent() {
 	log(LogLevel::INFO, LogCategory::REPORT_SENT, LogMessage::DEV_REPORT_SENT,
-		0, ::gettext("Report sent"));
+		LOG_FORMAT("Report sent"));
 }
 
 } // namespace hid_identify
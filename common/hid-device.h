@@ -1,6 +1,6 @@
 /*
 	qmk-hid-identify - Identify the current OS to QMK device
-	Copyright 2021  Simon Arlott
+	Copyright 2021,2026  Simon Arlott
 
 	This program is free software: you can redistribute it and/or modify
 	it under the terms of the GNU General Public License as published by
@@ -17,44 +17,161 @@
 */
 #pragma once
 
-#include <string>
-#include <vector>
+#include <array>
+#include <cstddef>
+#include <cstdint>
 
+#include "log-filter.h"
+#include "log-format.h"
 #include "types.h"
 
 namespace hid_identify {
 
-std::vector<uint8_t> os_identity();
+std::array<uint8_t, 4> os_identity();
 
 class HIDDevice {
 public:
 	virtual ~HIDDevice() = default;
 
-	void open();
-	void identify();
+	/*
+	 * Devices that can't be identified are rejected by returning the reason,
+	 * errors are thrown as exceptions.
+	 */
+	Rejection open();
+	Rejection identify();
 	void close() noexcept;
 
+	/*
+	 * Prepare the report without sending it, for when it will be sent
+	 * externally. The report remains valid until the device is closed.
+	 */
+	Rejection prepare_identify();
+	const uint8_t* report() const { return report_.data(); }
+	size_t report_length() const { return report_length_; }
+
+	/*
+	 * Check if a device could be identified based on its device information
+	 * alone, so that lists of devices can be filtered before opening them.
+	 */
+	static bool device_allowed(const USBDeviceInfo &device_info);
+
+	/*
+	 * Get the report count of the QMK raw HID interface in a list of reports,
+	 * or 0 if there isn't one.
+	 */
+	static uint32_t raw_report_count(const HIDReports &reports);
+
+	/*
+	 * Get the report count of a report if it is the QMK raw HID interface,
+	 * or 0 if it isn't.
+	 */
+	static uint32_t raw_report_count(const HIDReports &reports, size_t report);
+
+	/* Add the QMK raw HID interface report with a report count */
+	static void add_raw_report(HIDReports &reports, uint32_t report_count);
+
+	static constexpr uint32_t RAW_USAGE_PAGE = 0xFF60;
+	static constexpr uint32_t RAW_USAGE_ID = 0x0061;
+	static constexpr uint32_t RAW_IN_USAGE_ID = 0x0062;
+	static constexpr uint32_t RAW_OUT_USAGE_ID = 0x0063;
+
+	/* Stages of identifying a device, in the order that they happen */
+	enum class Stage : uint8_t {
+		/* Get device information without opening the device */
+		PROBE,
+		CHECK_ALLOWED,
+		OPEN,
+		/* Get device information and the name from the device */
+		IOCTL,
+		READ_DESCRIPTOR,
+		PARSE_DESCRIPTOR,
+		CHECK_REPORTS,
+		/* Prepare and send the report */
+		WRITE,
+	};
+
+	static constexpr size_t STAGES = 8;
+	static constexpr std::array<const char*, STAGES> STAGE_NAMES{
+		"probe",
+		"check allowed",
+		"open",
+		"ioctl",
+		"read descriptor",
+		"parse descriptor",
+		"check reports",
+		"write",
+	};
+
+	/* Time taken by each stage (nanoseconds) */
+	using StageTimes = std::array<uint64_t, STAGES>;
+
+	/*
+	 * Add the time taken by each stage of identify() to times, which must
+	 * remain valid until this is called again with nullptr.
+	 */
+	void measure_stages(StageTimes *times) noexcept { stage_times_ = times; }
+
 	HIDDevice(const HIDDevice&) = delete;
 	HIDDevice& operator=(const HIDDevice&) = delete;
 
 protected:
 	HIDDevice() = default;
 
-	virtual void log(LogLevel level, LogCategory category, LogMessage message,
-		int argc, const char *format...) noexcept = 0;
-
-	virtual void open(USBDeviceInfo &device_info, std::vector<HIDReport> &reports) = 0;
-	virtual void send_report(std::vector<uint8_t> &data) = 0;
+	template <class Format, class... Args>
+	void log(LogLevel level, LogCategory category, LogMessage message,
+			Format format, const Args&... args) noexcept {
+		if (log_enabled(level, category)) {
+			LogArgs values{format, args...};
+			log_message(level, category, message, values.format(message), values.data(), values.size());
+		}
+	}
+
+	virtual void log_message(LogLevel level, LogCategory category, LogMessage message,
+		const char *format, const LogArg *args, size_t count) noexcept = 0;
+
+	/*
+	 * Get device information without opening the device so that devices
+	 * that aren't allowed can be rejected early. Returns false if this is
+	 * not possible.
+	 */
+	virtual bool probe(USBDeviceInfo &device_info);
+	virtual Rejection open(USBDeviceInfo &device_info, HIDReports &reports) = 0;
+	virtual void send_report(const uint8_t *data, size_t length) = 0;
 	virtual void reset() noexcept;
 
+	/* Log that the report has been sent */
+	virtual void report_sent();
+
+	/* End the current stage, if stages are being measured */
+	void end_stage(Stage stage) noexcept {
+		if (stage_times_ != nullptr) {
+			record_stage(stage);
+		}
+	}
+
+	/* USB device information, if the device has been probed or opened */
+	const USBDeviceInfo& device_info() const { return device_info_; }
+
 private:
-	void check_device_allowed();
-	void check_device_reports();
-	void send_report();
+	Rejection check_device_allowed();
+	Rejection check_device_reports();
+	void prepare_report();
+	void begin_stages() noexcept;
+	void record_stage(Stage stage) noexcept;
 
 	USBDeviceInfo device_info_;
-	std::vector<HIDReport> reports_;
+	HIDReports reports_;
 	uint32_t report_count_ = 0;
+
+	/* Report ID and the largest USB (high speed) interrupt transfer */
+	static constexpr size_t MAX_REPORT_LENGTH = 1 + 1024;
+
+	std::array<uint8_t, MAX_REPORT_LENGTH> report_;
+	size_t report_length_ = 0;
+
+	StageTimes *stage_times_ = nullptr;
+	/* Monotonic raw clock time that the current stage started (nanoseconds) */
+	uint64_t stage_start_ = 0;
 };
 
 } // namespace hid_identify
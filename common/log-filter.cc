@@ -0,0 +1,114 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "log-filter.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "types.h"
+
+namespace hid_identify {
+
+namespace {
+
+struct CategoryLimit {
+	/* Start of the current interval (steady clock nanoseconds) */
+	std::atomic<int64_t> start;
+	/* Messages logged in the current interval */
+	std::atomic<unsigned int> count;
+	/* Messages suppressed since they were last reported */
+	std::atomic<unsigned long> suppressed;
+};
+
+} // namespace
+
+/* Category values are smaller than this on all platforms */
+static constexpr size_t MAX_CATEGORIES = 8;
+
+/* Log levels have lower values for more severe messages on all platforms */
+static std::atomic<unsigned int> max_level{static_cast<unsigned int>(LogLevel::INFO)};
+
+static std::atomic<unsigned int> limit_messages;
+static std::atomic<int64_t> limit_interval_ns;
+static std::array<CategoryLimit, MAX_CATEGORIES> limits;
+
+void set_log_level(LogLevel level) noexcept {
+	max_level.store(static_cast<unsigned int>(level), std::memory_order_relaxed);
+}
+
+void set_log_rate_limit(unsigned int messages, std::chrono::milliseconds interval) noexcept {
+	limit_messages.store(messages, std::memory_order_relaxed);
+	limit_interval_ns.store(messages ? std::chrono::nanoseconds{interval}.count() : 0,
+		std::memory_order_relaxed);
+}
+
+std::chrono::milliseconds log_rate_limit_interval() noexcept {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::nanoseconds{limit_interval_ns.load(std::memory_order_relaxed)});
+}
+
+bool log_enabled(LogLevel level, LogCategory category) noexcept {
+	if (static_cast<unsigned int>(level) > max_level.load(std::memory_order_relaxed)) {
+		return false;
+	}
+
+	unsigned int messages = limit_messages.load(std::memory_order_relaxed);
+	size_t index = static_cast<size_t>(category);
+
+	if (messages == 0 || index >= limits.size()) {
+		return true;
+	}
+
+	auto &limit = limits[index];
+	int64_t interval = limit_interval_ns.load(std::memory_order_relaxed);
+	int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+	int64_t start = limit.start.load(std::memory_order_relaxed);
+
+	/*
+	 * Messages logged by other threads at the start of a new interval may
+	 * be counted in the previous one, which doesn't matter.
+	 */
+	if (now - start >= interval
+			&& limit.start.compare_exchange_strong(start, now, std::memory_order_relaxed)) {
+		limit.count.store(0, std::memory_order_relaxed);
+	}
+
+	if (limit.count.load(std::memory_order_relaxed) < messages
+			&& limit.count.fetch_add(1, std::memory_order_relaxed) < messages) {
+		return true;
+	}
+
+	limit.suppressed.fetch_add(1, std::memory_order_relaxed);
+	return false;
+}
+
+unsigned long log_suppressed(LogCategory category) noexcept {
+	size_t index = static_cast<size_t>(category);
+
+	if (index >= limits.size()) {
+		return 0;
+	}
+
+	return limits[index].suppressed.exchange(0, std::memory_order_relaxed);
+}
+
+} // namespace hid_identify
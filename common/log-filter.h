@@ -0,0 +1,56 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <chrono>
+
+#include "types.h"
+
+namespace hid_identify {
+
+/*
+ * Messages are filtered by level and by a limit on the number of messages in
+ * each category in an interval, before they're translated or formatted. The
+ * caller has already evaluated the arguments, so arguments that are costly
+ * to build (e.g. error strings) should only be used for errors, which are
+ * never below the log level.
+ *
+ * Messages that exceed the limit are counted so that the number suppressed
+ * can be logged instead. Messages below the log level are not counted
+ * because they were never requested.
+ */
+
+/* Maximum level of messages to log (all levels by default) */
+void set_log_level(LogLevel level) noexcept;
+
+/*
+ * Maximum number of messages to log in each category in an interval, or 0
+ * for no limit (the default).
+ */
+void set_log_rate_limit(unsigned int messages, std::chrono::milliseconds interval) noexcept;
+
+/* Interval of the rate limit, or 0 if there is no limit */
+std::chrono::milliseconds log_rate_limit_interval() noexcept;
+
+/* Check if a message should be logged, counting it if it's rate limited */
+bool log_enabled(LogLevel level, LogCategory category) noexcept;
+
+/* Get and reset the number of messages suppressed in a category */
+unsigned long log_suppressed(LogCategory category) noexcept;
+
+} // namespace hid_identify
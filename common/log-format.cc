@@ -0,0 +1,106 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "log-format.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstring>
+
+namespace hid_identify {
+
+const char *LogArg::text(Buffer &buf) const noexcept {
+	std::to_chars_result result;
+
+	switch (type_) {
+	case Type::STRING:
+		return string_ != nullptr ? string_ : "(null)";
+
+	case Type::SIGNED:
+		result = std::to_chars(buf.data(), buf.data() + buf.size() - 1, signed_);
+		break;
+
+	case Type::UNSIGNED:
+		result = std::to_chars(buf.data(), buf.data() + buf.size() - 1, unsigned_);
+		break;
+	}
+
+	*result.ptr = '\0';
+	return buf.data();
+}
+
+char *LogArg::write(char *first, char *last) const noexcept {
+	size_t size = last - first;
+
+	if (type_ != Type::STRING && size >= MAX_INTEGER_LENGTH) {
+		auto result = (type_ == Type::SIGNED)
+			? std::to_chars(first, last, signed_)
+			: std::to_chars(first, last, unsigned_);
+
+		return result.ptr;
+	}
+
+	Buffer buf;
+	const char *text = this->text(buf);
+	size_t length = 0;
+
+	while (length < size && text[length]) {
+		length++;
+	}
+
+	std::memcpy(first, text, length);
+	return first + length;
+}
+
+size_t log_format(char *buf, size_t size, const char *format,
+		const LogArg *args, size_t count) noexcept {
+	char *pos = buf;
+	char *last = buf + size - 1;
+	size_t arg = 0;
+
+	while (*format && pos != last) {
+		const char *next = std::strchr(format, '%');
+		size_t length = (next != nullptr) ? next - format : std::strlen(format);
+
+		length = std::min(length, static_cast<size_t>(last - pos));
+		std::memcpy(pos, format, length);
+		pos += length;
+		format += length;
+
+		if (next == nullptr || format != next || pos == last) {
+			continue;
+		}
+
+		if (format[1] == 's') {
+			if (arg < count) {
+				pos = args[arg++].write(pos, last);
+			}
+			format += 2;
+		} else if (format[1] == '%') {
+			*pos++ = '%';
+			format += 2;
+		} else {
+			*pos++ = *format++;
+		}
+	}
+
+	*pos = '\0';
+	return pos - buf;
+}
+
+} // namespace hid_identify
@@ -0,0 +1,159 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+#include "logging.h"
+
+/*
+ * Format of a log message, which must be a string literal so that it can be
+ * checked at compile time. Each "%s" is replaced by the next argument and
+ * "%%" is replaced by "%". The text is translated when the message is logged
+ * (use "--keyword=LOG_FORMAT" with xgettext).
+ */
+#define LOG_FORMAT(literal) ([] { \
+		struct LogFormat { \
+			static constexpr const char *text() { return literal; } \
+		}; \
+		return LogFormat{}; \
+	}())
+
+namespace hid_identify {
+
+/*
+ * Number of arguments used by a log message format, or -1 if it contains
+ * anything other than "%s" or "%%".
+ */
+constexpr int log_format_arguments(const char *format) {
+	int count = 0;
+
+	for (; *format; format++) {
+		if (*format != '%') {
+			continue;
+		}
+
+		format++;
+		if (*format == 's') {
+			count++;
+		} else if (*format != '%') {
+			return -1;
+		}
+	}
+
+	return count;
+}
+
+/*
+ * Hash of a log message format (32-bit FNV-1a, but never 0), which is used
+ * to check that a translation is for the same text.
+ */
+constexpr uint32_t log_format_hash(const char *format) {
+	uint32_t hash = 0x811C9DC5U;
+
+	for (; *format; format++) {
+		hash ^= static_cast<uint8_t>(*format);
+		hash *= 0x01000193U;
+	}
+
+	return hash ? hash : 1;
+}
+
+/* Argument for a log message, which is converted to text when it's formatted */
+class LogArg {
+public:
+	/* Maximum length of an integer (including the sign) */
+	static constexpr size_t MAX_INTEGER_LENGTH = 20;
+
+	using Buffer = std::array<char, MAX_INTEGER_LENGTH + 1>;
+
+	LogArg(const char *value) noexcept : type_(Type::STRING), string_(value) {}
+	LogArg(const std::string &value) noexcept : LogArg(value.c_str()) {}
+
+	template <class T, std::enable_if_t<std::is_integral_v<T>
+		&& !std::is_same_v<T, bool> && !std::is_same_v<T, char>, int> = 0>
+	LogArg(T value) noexcept {
+		if constexpr (std::is_signed_v<T>) {
+			type_ = Type::SIGNED;
+			signed_ = value;
+		} else {
+			type_ = Type::UNSIGNED;
+			unsigned_ = value;
+		}
+	}
+
+	/* Get the text of the argument, using the buffer if it's an integer */
+	const char *text(Buffer &buf) const noexcept;
+
+	/* Write the text of the argument, truncating it at the end of the buffer */
+	char *write(char *first, char *last) const noexcept;
+
+private:
+	enum class Type : uint8_t {
+		STRING,
+		SIGNED,
+		UNSIGNED,
+	};
+
+	Type type_;
+	union {
+		const char *string_;
+		long long signed_;
+		unsigned long long unsigned_;
+	};
+};
+
+/* Log message format and arguments, with the number of arguments checked */
+template <class Format, size_t N>
+class LogArgs {
+public:
+	template <class... Args>
+	explicit LogArgs(Format, const Args&... args) noexcept : args_{{LogArg{args}...}} {
+		static_assert(log_format_arguments(Format::text()) == static_cast<int>(N),
+			"Wrong number of arguments for log message format");
+	}
+
+	/* Translated format, for this message if it's always logged with the same text */
+	const char *format(LogMessage message) const noexcept {
+		static constexpr uint32_t hash = log_format_hash(Format::text());
+
+		return log_translate(message, hash, Format::text());
+	}
+
+	const LogArg *data() const noexcept { return args_.data(); }
+	size_t size() const noexcept { return args_.size(); }
+
+private:
+	const std::array<LogArg, N> args_;
+};
+
+template <class Format, class... Args>
+LogArgs(Format, const Args&...) -> LogArgs<Format, sizeof...(Args)>;
+
+/*
+ * Format a log message into a buffer, truncating it if it doesn't fit, and
+ * return its length.
+ */
+size_t log_format(char *buf, size_t size, const char *format,
+	const LogArg *args, size_t count) noexcept;
+
+} // namespace hid_identify
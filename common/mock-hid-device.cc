@@ -0,0 +1,101 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "mock-hid-device.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "hid-device.h"
+#include "log-format.h"
+#include "types.h"
+
+namespace hid_identify {
+
+/* Reports (and their total length) that can be sent without allocating memory */
+static constexpr size_t RESERVED_FRAMES = 4;
+static constexpr size_t RESERVED_FRAME_DATA = 4096;
+
+MockHIDDevice::MockHIDDevice(const USBDeviceInfo &device_info,
+		const HIDReports &reports, bool probe)
+		: device_info_(device_info), reports_(reports), probe_(probe) {
+	reserve_frames();
+}
+
+MockHIDDevice::MockHIDDevice(const USBDeviceInfo &device_info,
+		const std::vector<uint8_t> &report_descriptor, ReportParser parser, bool probe)
+		: device_info_(device_info), reports_(), report_descriptor_(report_descriptor),
+			parser_(parser), probe_(probe) {
+	reserve_frames();
+}
+
+void MockHIDDevice::reserve_frames() {
+	frame_data_.reserve(RESERVED_FRAME_DATA);
+	frame_ends_.reserve(RESERVED_FRAMES);
+}
+
+const uint8_t* MockHIDDevice::frame(size_t index) const {
+	return frame_data_.data() + (index > 0 ? frame_ends_[index - 1] : 0);
+}
+
+size_t MockHIDDevice::frame_length(size_t index) const {
+	return frame_ends_[index] - (index > 0 ? frame_ends_[index - 1] : 0);
+}
+
+void MockHIDDevice::clear_frames() {
+	frame_data_.clear();
+	frame_ends_.clear();
+}
+
+void MockHIDDevice::log_message(LogLevel level __attribute__((unused)),
+		LogCategory category __attribute__((unused)),
+		LogMessage message __attribute__((unused)),
+		const char *format, const LogArg *args, size_t count) noexcept {
+	std::array<char, 256> text;
+
+	log_format(text.data(), text.size(), format, args, count);
+}
+
+bool MockHIDDevice::probe(USBDeviceInfo &device_info) {
+	if (!probe_) {
+		return false;
+	}
+
+	device_info = device_info_;
+	return true;
+}
+
+Rejection MockHIDDevice::open(USBDeviceInfo &device_info, HIDReports &reports) {
+	device_info = device_info_;
+	opened_++;
+
+	if (parser_ != nullptr) {
+		return parser_(report_descriptor_.data(), report_descriptor_.size(), reports);
+	}
+
+	reports = reports_;
+	return Rejection::NONE;
+}
+
+void MockHIDDevice::send_report(const uint8_t *data, size_t length) {
+	frame_data_.insert(frame_data_.end(), data, data + length);
+	frame_ends_.push_back(frame_data_.size());
+}
+
+} // namespace hid_identify
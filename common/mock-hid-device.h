@@ -0,0 +1,82 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "hid-device.h"
+#include "types.h"
+
+namespace hid_identify {
+
+/*
+ * HID device that only exists in memory, so that identifying devices can be
+ * exercised without a real device. The device information and reports (or
+ * a report descriptor to parse every time it's opened) are provided when it
+ * is created and every report sent to it is recorded. Log messages are
+ * formatted but not written anywhere.
+ */
+class MockHIDDevice: public HIDDevice {
+public:
+	/* Parse all of the reports in a report descriptor */
+	using ReportParser = Rejection (*)(const uint8_t *report_descriptor, size_t size,
+		HIDReports &reports);
+
+	/*
+	 * If probe is true then the device information is available without
+	 * opening the device, otherwise it is only available after opening it.
+	 */
+	MockHIDDevice(const USBDeviceInfo &device_info, const HIDReports &reports,
+		bool probe = true);
+	MockHIDDevice(const USBDeviceInfo &device_info, const std::vector<uint8_t> &report_descriptor,
+		ReportParser parser, bool probe = true);
+
+	size_t opened() const { return opened_; }
+
+	/* Reports that have been sent, in the order they were sent */
+	size_t frames() const { return frame_ends_.size(); }
+	const uint8_t* frame(size_t index) const;
+	size_t frame_length(size_t index) const;
+
+	/* Forget the reports that have been sent, without freeing any memory */
+	void clear_frames();
+
+protected:
+	void log_message(LogLevel level, LogCategory category, LogMessage message,
+		const char *format, const LogArg *args, size_t count) noexcept override;
+
+	bool probe(USBDeviceInfo &device_info) override;
+	Rejection open(USBDeviceInfo &device_info, HIDReports &reports) override;
+	void send_report(const uint8_t *data, size_t length) override;
+
+private:
+	void reserve_frames();
+
+	const USBDeviceInfo device_info_;
+	const HIDReports reports_;
+	const std::vector<uint8_t> report_descriptor_;
+	const ReportParser parser_ = nullptr;
+	const bool probe_;
+	size_t opened_ = 0;
+	std::vector<uint8_t> frame_data_;
+	std::vector<size_t> frame_ends_;
+};
+
+} // namespace hid_identify
@@ -1,6 +1,6 @@
 /*
 	qmk-hid-identify - Identify the current OS to QMK device
-	Copyright 2021-2022  Simon Arlott
+	Copyright 2021-2022,2026  Simon Arlott
 
 	This program is free software: you can redistribute it and/or modify
 	it under the terms of the GNU General Public License as published by
@@ -17,8 +17,12 @@
 */
 #pragma once
 
+#include <array>
+#include <cstddef>
 #include <cstdint>
+#include <cstdlib>
 #include <exception>
+#include <utility>
 #include <vector>
 
 #include "logging.h"
@@ -63,15 +67,18 @@ enum class LogCategory : unsigned short {
 
 enum class LogMessage : unsigned int {
 	LOGGING_MESSAGE(DEV_REPORT_SENT),
+	LOGGING_MESSAGE(DEV_REPORT_SENT_LATENCY),
 
 	LOGGING_MESSAGE(DEV_NOT_ALLOWED),
 	LOGGING_MESSAGE(DEV_UNKNOWN_USAGE),
 	LOGGING_MESSAGE(DEV_UNKNOWN_USB_INTERFACE_NUMBER),
 	LOGGING_MESSAGE(DEV_NO_HID_ATTRIBUTES),
 	LOGGING_MESSAGE(DEV_ACCESS_DENIED),
+	LOGGING_MESSAGE(DEV_TOO_MANY_REPORTS),
 
 	LOGGING_MESSAGE(DEV_REPORT_COUNT_TOO_SMALL),
 	LOGGING_MESSAGE(DEV_REPORT_LENGTH_TOO_SMALL),
+	LOGGING_MESSAGE(DEV_REPORT_COUNT_TOO_LARGE),
 
 	LOGGING_MESSAGE(DEV_WRITE_FAILED),
 	LOGGING_MESSAGE(DEV_WRITE_TIMEOUT),
@@ -96,8 +103,14 @@ enum class LogMessage : unsigned int {
 
 	LOGGING_MESSAGE(SVC_POWER_RESUME),
 
+	LOGGING_MESSAGE(SVC_UEVENT_OVERFLOW),
+	LOGGING_MESSAGE(SVC_DEVICE_OVERRIDES_INVALID),
+
 	LOGGING_MESSAGE(SVC_OS_FUNC_ERROR_CODE_1),
 	LOGGING_MESSAGE(SVC_OS_FUNC_ERROR_CODE_2),
+
+	LOGGING_MESSAGE(SVC_LOG_SUPPRESSED),
+	LOGGING_MESSAGE(SVC_LOG_DROPPED),
 };
 
 #undef LOGGING_MESSAGE
@@ -109,30 +122,219 @@ public:
 	int16_t interface_number;
 };
 
+/* Values of an Input, Output or Feature item */
 struct HIDCollection {
 public:
-	bool has_usage;
+	/* Presence of each value */
+	static constexpr uint8_t HAS_USAGE = 1U << 0;
+	static constexpr uint8_t HAS_MINIMUM = 1U << 1;
+	static constexpr uint8_t HAS_MAXIMUM = 1U << 2;
+	static constexpr uint8_t HAS_COUNT = 1U << 3;
+	static constexpr uint8_t HAS_SIZE = 1U << 4;
+	static constexpr uint8_t HAS_ALL = HAS_USAGE | HAS_MINIMUM | HAS_MAXIMUM | HAS_COUNT | HAS_SIZE;
+
+	uint8_t flags;
 	uint32_t usage;
-	bool has_minimum;
 	uint32_t minimum;
-	bool has_maximum;
 	uint32_t maximum;
-	bool has_count;
 	uint32_t count;
-	bool has_size;
 	uint32_t size;
 };
 
-struct HIDReport {
+enum class HIDReportType : uint8_t {
+	INPUT = 0,
+	OUTPUT = 1,
+	FEATURE = 2,
+};
+
+/*
+ * Reports (top-level collections) and their Input, Output and Feature items,
+ * stored in a fixed size arena as a structure of arrays so that they can be
+ * built and checked without any memory allocation.
+ *
+ * Reports are built one at a time: items can only be added to the last
+ * report. The items of each type are stored contiguously so each report has
+ * a range of items of each type.
+ *
+ * Reports and items that don't fit are counted but not stored, and have a
+ * usage page/usage of 0 or no values present. Devices with reports that
+ * don't fit must be rejected (check overflow()) because they can't be
+ * checked completely.
+ */
+class HIDReports {
 public:
-	uint32_t usage_page;
-	uint32_t usage;
+	static constexpr size_t CAPACITY = 4;
+	static constexpr size_t ITEM_CAPACITY = 8;
+
+	/* Add a report, with a usage page and usage of 0 until they're set */
+	void add_report() {
+		if (count_ < CAPACITY) {
+			usage_page_[count_] = 0;
+			usage_[count_] = 0;
+
+			for (size_t type = 0; type < TYPES; type++) {
+				item_begin_[count_][type] = items_[type].total;
+				item_count_[count_][type] = 0;
+			}
+		}
+		count_++;
+	}
+
+	/* Set the usage page and usage of the last report */
+	void set_usage(uint32_t usage_page, uint32_t usage) {
+		if (count_ <= CAPACITY) {
+			usage_page_[count_ - 1] = usage_page;
+			usage_[count_ - 1] = usage;
+		}
+	}
+
+	/* Add an item to the last report */
+	void add_item(HIDReportType type, const HIDCollection &item) {
+		if (count_ <= CAPACITY) {
+			auto &items = items_[static_cast<size_t>(type)];
+
+			if (items.total < ITEM_CAPACITY) {
+				items.flags[items.total] = item.flags;
+				items.usage[items.total] = item.usage;
+				items.minimum[items.total] = item.minimum;
+				items.maximum[items.total] = item.maximum;
+				items.count[items.total] = item.count;
+				items.size[items.total] = item.size;
+			}
+
+			items.total++;
+			item_count_[count_ - 1][static_cast<size_t>(type)]++;
+		}
+	}
+
+	/* Remove the last report and its items */
+	void pop_back() {
+		count_--;
+
+		if (count_ < CAPACITY) {
+			for (size_t type = 0; type < TYPES; type++) {
+				items_[type].total = item_begin_[count_][type];
+			}
+		}
+	}
+
+	void clear() {
+		count_ = 0;
+
+		for (auto& items : items_) {
+			items.total = 0;
+		}
+	}
+
+	size_t size() const { return count_; }
+	bool empty() const { return count_ == 0; }
+
+	/* Check if any reports or items have not been stored */
+	bool overflow() const {
+		if (count_ > CAPACITY) {
+			return true;
+		}
+
+		for (const auto& items : items_) {
+			if (items.total > ITEM_CAPACITY) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	uint32_t usage_page(size_t report) const { return report < CAPACITY ? usage_page_[report] : 0; }
+	uint32_t usage(size_t report) const { return report < CAPACITY ? usage_[report] : 0; }
+
+	/* Number of items of a type in a report */
+	size_t items(size_t report, HIDReportType type) const {
+		return report < CAPACITY ? item_count_[report][static_cast<size_t>(type)] : 0;
+	}
+
+	/* Get an item of a type in a report */
+	HIDCollection item(size_t report, HIDReportType type, size_t index) const {
+		if (report >= CAPACITY) {
+			return {};
+		}
+
+		const auto &items = items_[static_cast<size_t>(type)];
+		size_t pos = item_begin_[report][static_cast<size_t>(type)] + index;
+
+		if (pos >= ITEM_CAPACITY) {
+			return {};
+		}
+
+		return { items.flags[pos], items.usage[pos], items.minimum[pos],
+			items.maximum[pos], items.count[pos], items.size[pos] };
+	}
+
+private:
+	static constexpr size_t TYPES = 3;
+
+	struct Items {
+		std::array<uint8_t, ITEM_CAPACITY> flags;
+		std::array<uint32_t, ITEM_CAPACITY> usage;
+		std::array<uint32_t, ITEM_CAPACITY> minimum;
+		std::array<uint32_t, ITEM_CAPACITY> maximum;
+		std::array<uint32_t, ITEM_CAPACITY> count;
+		std::array<uint32_t, ITEM_CAPACITY> size;
+		uint16_t total; /* Including items that weren't stored */
+	};
+
+	std::array<uint32_t, CAPACITY> usage_page_{};
+	std::array<uint32_t, CAPACITY> usage_{};
+	std::array<std::array<uint16_t, TYPES>, CAPACITY> item_begin_{};
+	std::array<std::array<uint16_t, TYPES>, CAPACITY> item_count_{};
+	size_t count_ = 0;
+
+	std::array<Items, TYPES> items_{};
+};
+
+/*
+ * Reasons for not identifying a device. Most devices are rejected so these
+ * are returned instead of being thrown as exceptions, which are only used
+ * for errors.
+ */
+enum class [[nodiscard]] Rejection : uint8_t {
+	NONE = 0,
+	DISALLOWED_USB_DEVICE,
+	UNSUPPORTED_HID_REPORT_DESCRIPTOR,
+	MALFORMED_HID_REPORT_DESCRIPTOR,
+	UNSUPPORTED_HID_REPORT_USAGE,
+};
 
-	std::vector<HIDCollection> in;
-	std::vector<HIDCollection> out;
-	std::vector<HIDCollection> feature;
+/* Either a value or the reason that a device was rejected */
+template <typename T>
+class [[nodiscard]] Expected {
+public:
+	Expected(T value) : value_(value) {}
+	Expected(Rejection rejection) : rejection_(rejection) {}
+
+	explicit operator bool() const { return rejection_ == Rejection::NONE; }
+	const T& operator*() const { return value_; }
+	const T& value() const { return value_; }
+	Rejection rejection() const { return rejection_; }
+
+private:
+	T value_{};
+	Rejection rejection_ = Rejection::NONE;
 };
 
+/*
+ * When built without exceptions (-fno-exceptions) errors are fatal, so
+ * handlers for them are never used.
+ */
+#ifdef __cpp_exceptions
+#	define HID_TRY try
+#	define HID_CATCH(...) catch (__VA_ARGS__)
+#	define HID_RETHROW throw
+#else
+#	define HID_TRY if (true)
+#	define HID_CATCH(...) else if (false)
+#	define HID_RETHROW std::abort()
+#endif
+
 class Exception: public std::exception {
 public:
 	virtual ~Exception() = default;
@@ -191,5 +393,20 @@ public:
 	UnsupportedHIDReportUsage() noexcept = default;
 };
 
+/*
+ * Exit with the exit status for an error, for when it can't be thrown
+ * because exceptions are disabled.
+ */
+[[noreturn]] void exit_error(const Exception &e) noexcept;
+
+/* Throw an error, or exit if exceptions are disabled */
+template <typename T>
+[[noreturn]] inline void throw_error(T &&e) {
+#ifdef __cpp_exceptions
+	throw std::forward<T>(e);
+#else
+	exit_error(e);
+#endif
+}
 
 } // namespace hid_identify
@@ -1,6 +1,6 @@
 /*
 	qmk-hid-identify - Identify the current OS to QMK device
-	Copyright 2021  Simon Arlott
+	Copyright 2021,2026  Simon Arlott
 
 	This program is free software: you can redistribute it and/or modify
 	it under the terms of the GNU General Public License as published by
@@ -17,29 +17,33 @@
 */
 #include "usb-vid-pid.h"
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 
+#include "usb-vid-pid-table.h"
+
 namespace hid_identify {
 
-struct USBDevice {
-public:
-	uint16_t vid;
-	uint16_t pid;
-	uint16_t pid_mask;
+static_assert(usb_device_table_valid<AllowedUSBDevices>(), "Allowed USB device table is invalid");
+
+/* Overrides are sorted by key for each distinct PID mask */
+struct USBDeviceOverrides {
+	std::vector<uint16_t> pid_masks;
+	std::vector<uint64_t> allowed;
+	std::vector<uint64_t> denied;
 };
 
-bool usb_device_allowed(uint16_t vid, uint16_t pid) {
-	static const std::vector<USBDevice> devices{
-		{ 0x1209, 0x0000, 0xF000 },
-		{ 0x16C0, 0x05DF, 0xFFFF },
-		{ 0x16C0, 0x27D9, 0xFFFF },
-		{ 0x16C0, 0x27DA, 0xFFFE },
-		{ 0x16C0, 0x27DC, 0xFFFF },
-	};
-
-	for (auto& device : devices) {
-		if (vid == device.vid && (pid & device.pid_mask) == device.pid) {
+static USBDeviceOverrides device_overrides;
+
+static bool find_override(const std::vector<uint64_t> &keys, uint16_t vid, uint16_t pid) {
+	if (keys.empty()) {
+		return false;
+	}
+
+	for (uint16_t pid_mask : device_overrides.pid_masks) {
+		if (std::binary_search(keys.begin(), keys.end(), usb_device_key(vid, pid, pid_mask))) {
 			return true;
 		}
 	}
@@ -47,4 +51,123 @@ bool usb_device_allowed(uint16_t vid, uint16_t pid) {
 	return false;
 }
 
+static bool parse_hex(const char *&pos, const char *end, uint16_t &value) {
+	unsigned int result = 0;
+	const char *start = pos;
+
+	for (; pos < end && pos - start < 4; pos++) {
+		if (*pos >= '0' && *pos <= '9') {
+			result = result * 16 + (*pos - '0');
+		} else if (*pos >= 'A' && *pos <= 'F') {
+			result = result * 16 + (*pos - 'A' + 10);
+		} else if (*pos >= 'a' && *pos <= 'f') {
+			result = result * 16 + (*pos - 'a' + 10);
+		} else {
+			break;
+		}
+	}
+
+	value = result;
+	return pos != start && (pos == end || *pos == ' ' || *pos == '\t' || *pos == '\r' || *pos == '#');
+}
+
+static void skip_space(const char *&pos, const char *end) {
+	while (pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\r')) {
+		pos++;
+	}
+}
+
+static bool parse_override(const char *pos, const char *end, std::vector<USBDeviceOverride> &overrides) {
+	USBDeviceOverride entry{{ 0, 0, UINT16_MAX }, true};
+
+	skip_space(pos, end);
+	if (pos == end || *pos == '#') {
+		return true;
+	}
+
+	if (*pos == '!') {
+		entry.allowed = false;
+		pos++;
+		skip_space(pos, end);
+	}
+
+	if (!parse_hex(pos, end, entry.device.vid)) {
+		return false;
+	}
+
+	skip_space(pos, end);
+	if (!parse_hex(pos, end, entry.device.pid)) {
+		return false;
+	}
+
+	skip_space(pos, end);
+	if (pos < end && *pos != '#' && !parse_hex(pos, end, entry.device.pid_mask)) {
+		return false;
+	}
+
+	skip_space(pos, end);
+	if (pos < end && *pos != '#') {
+		return false;
+	}
+
+	if (entry.device.pid & ~entry.device.pid_mask) {
+		return false;
+	}
+
+	overrides.push_back(entry);
+	return true;
+}
+
+bool usb_device_allowed(uint16_t vid, uint16_t pid) {
+	if (find_override(device_overrides.denied, vid, pid)) {
+		return false;
+	}
+
+	return usb_device_in_table<AllowedUSBDevices>(vid, pid)
+		|| find_override(device_overrides.allowed, vid, pid);
+}
+
+bool usb_device_parse_overrides(const char *data, size_t size,
+		std::vector<USBDeviceOverride> &overrides, size_t &error_line) {
+	const char *end = data + size;
+
+	overrides.clear();
+	error_line = 0;
+
+	for (const char *line = data; line < end; ) {
+		const char *line_end = std::find(line, end, '\n');
+
+		error_line++;
+		if (!parse_override(line, line_end, overrides)) {
+			overrides.clear();
+			return false;
+		}
+
+		line = line_end < end ? line_end + 1 : end;
+	}
+
+	error_line = 0;
+	return true;
+}
+
+void usb_device_set_overrides(const std::vector<USBDeviceOverride> &overrides) {
+	device_overrides = {};
+
+	for (auto& entry : overrides) {
+		uint64_t key = usb_device_key(entry.device.vid, entry.device.pid, entry.device.pid_mask);
+
+		(entry.allowed ? device_overrides.allowed : device_overrides.denied).push_back(key);
+		device_overrides.pid_masks.push_back(entry.device.pid_mask);
+	}
+
+	auto &pid_masks = device_overrides.pid_masks;
+	std::sort(pid_masks.begin(), pid_masks.end());
+	pid_masks.erase(std::unique(pid_masks.begin(), pid_masks.end()), pid_masks.end());
+
+	for (auto *keys : { &device_overrides.allowed, &device_overrides.denied }) {
+		std::sort(keys->begin(), keys->end());
+		keys->erase(std::unique(keys->begin(), keys->end()), keys->end());
+	}
+}
+
 } // namespace hid_identify
@@ -1,6 +1,6 @@
 /*
 	qmk-hid-identify - Identify the current OS to QMK device
-	Copyright 2021  Simon Arlott
+	Copyright 2021,2026  Simon Arlott
 
 	This program is free software: you can redistribute it and/or modify
 	it under the terms of the GNU General Public License as published by
@@ -17,10 +17,89 @@
 */
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <vector>
 
 namespace hid_identify {
 
+struct USBDevice {
+public:
+	uint16_t vid;
+	uint16_t pid;
+	uint16_t pid_mask;
+};
+
+struct USBDeviceOverride {
+public:
+	USBDevice device;
+	bool allowed;
+};
+
 bool usb_device_allowed(uint16_t vid, uint16_t pid);
 
+/*
+ * Parse a list of devices to allow or deny in addition to the built-in list,
+ * in the same format as usb-vid-pid.txt with an optional "!" at the start of
+ * a line to deny a device. The whole list is rejected if any line is invalid,
+ * returning false with the line number.
+ */
+bool usb_device_parse_overrides(const char *data, size_t size,
+	std::vector<USBDeviceOverride> &overrides, size_t &error_line);
+
+/*
+ * Replace the current overrides. This must not be called while other threads
+ * could be checking devices.
+ */
+void usb_device_set_overrides(const std::vector<USBDeviceOverride> &overrides);
+
+/*
+ * Perfect hash table lookup for tables generated by usb-vid-pid.py, which
+ * must use the same hash functions.
+ */
+constexpr uint64_t usb_device_key(uint16_t vid, uint16_t pid, uint16_t pid_mask) {
+	return ((uint64_t)pid_mask << 32) | ((uint64_t)vid << 16) | (pid & pid_mask);
+}
+
+constexpr uint64_t usb_device_fmix64(uint64_t value) {
+	value ^= value >> 33;
+	value *= 0xFF51AFD7ED558CCDULL;
+	value ^= value >> 33;
+	value *= 0xC4CEB9FE1A85EC53ULL;
+	value ^= value >> 33;
+	return value;
+}
+
+template <class Table>
+constexpr bool usb_device_in_table(uint64_t key) {
+	uint16_t displacement = Table::DISPLACEMENTS[(usb_device_fmix64(key) >> 32)
+		& (Table::DISPLACEMENTS.size() - 1)];
+	uint64_t slot = usb_device_fmix64(key ^ ((displacement + 1ULL) * 0x9E3779B97F4A7C15ULL));
+
+	return Table::KEYS[slot & (Table::KEYS.size() - 1)] == key;
+}
+
+template <class Table>
+constexpr bool usb_device_in_table(uint16_t vid, uint16_t pid) {
+	for (uint16_t pid_mask : Table::PID_MASKS) {
+		if (usb_device_in_table<Table>(usb_device_key(vid, pid, pid_mask))) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* Check that every device in a generated table can be found */
+template <class Table>
+constexpr bool usb_device_table_valid() {
+	for (const auto& device : Table::DEVICES) {
+		if (!usb_device_in_table<Table>(device.vid, device.pid)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
 } // namespace hid_identify
@@ -0,0 +1,172 @@
+#!/usr/bin/env python3
+#
+#	qmk-hid-identify - Identify the current OS to QMK device
+#	Copyright 2026  Simon Arlott
+#
+#	This program is free software: you can redistribute it and/or modify
+#	it under the terms of the GNU General Public License as published by
+#	the Free Software Foundation, either version 3 of the License, or
+#	(at your option) any later version.
+#
+#	This program is distributed in the hope that it will be useful,
+#	but WITHOUT ANY WARRANTY; without even the implied warranty of
+#	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#	GNU General Public License for more details.
+#
+#	You should have received a copy of the GNU General Public License
+#	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#
+# Generate a perfect hash table of allowed USB devices from a list of
+# "<vid> <pid> [<pid mask>]" lines.
+#
+# There is one key for each entry, made from the PID mask, VID and masked PID.
+# Lookups hash the device with each of the distinct PID masks, so they take a
+# constant time regardless of the number of entries.
+#
+# The hash functions must match usb-vid-pid.h.
+#
+# Usage: usb-vid-pid.py [--name <struct name>] <input> <output>
+
+import argparse
+import sys
+
+MASK64 = (1 << 64) - 1
+EMPTY_KEY = MASK64
+MAX_DISPLACEMENT = 0xFFFF
+
+
+def fmix64(value):
+	value ^= value >> 33
+	value = (value * 0xFF51AFD7ED558CCD) & MASK64
+	value ^= value >> 33
+	value = (value * 0xC4CEB9FE1A85EC53) & MASK64
+	value ^= value >> 33
+	return value
+
+
+def key(vid, pid, pid_mask):
+	return (pid_mask << 32) | (vid << 16) | (pid & pid_mask)
+
+
+def bucket_hash(value):
+	return fmix64(value) >> 32
+
+
+def slot_hash(value, displacement):
+	return fmix64(value ^ (((displacement + 1) * 0x9E3779B97F4A7C15) & MASK64))
+
+
+def power_of_two(value):
+	size = 1
+	while size < value:
+		size <<= 1
+	return size
+
+
+def parse(filename):
+	entries = []
+
+	with open(filename, "r") as f:
+		for number, line in enumerate(f, 1):
+			line = line.split("#", 1)[0].split()
+			if not line:
+				continue
+
+			try:
+				if len(line) not in (2, 3):
+					raise ValueError("expected 2 or 3 values")
+
+				values = [int(value, 16) for value in line] + [0xFFFF]
+				vid, pid, pid_mask = values[0:3]
+
+				if not all(0 <= value <= 0xFFFF for value in (vid, pid, pid_mask)):
+					raise ValueError("value out of range")
+				if pid & ~pid_mask:
+					raise ValueError("PID has bits outside of the mask")
+			except ValueError as e:
+				sys.exit(f"{filename}:{number}: {e}")
+
+			entries.append((vid, pid, pid_mask))
+
+	return sorted(set(entries))
+
+
+def build(entries):
+	keys = [key(*entry) for entry in entries]
+	size = power_of_two(max(2 * len(keys), 1))
+	bucket_count = power_of_two(max((len(keys) + 1) // 2, 1))
+	buckets = [[] for _ in range(bucket_count)]
+
+	for value in keys:
+		buckets[bucket_hash(value) & (bucket_count - 1)].append(value)
+
+	table = [EMPTY_KEY] * size
+	displacements = [0] * bucket_count
+
+	for index in sorted(range(bucket_count), key=lambda index: -len(buckets[index])):
+		if not buckets[index]:
+			break
+
+		for displacement in range(MAX_DISPLACEMENT + 1):
+			slots = {slot_hash(value, displacement) & (size - 1) for value in buckets[index]}
+
+			if len(slots) == len(buckets[index]) and all(table[slot] == EMPTY_KEY for slot in slots):
+				for value in buckets[index]:
+					table[slot_hash(value, displacement) & (size - 1)] = value
+				displacements[index] = displacement
+				break
+		else:
+			sys.exit("Unable to create perfect hash table")
+
+	return table, displacements
+
+
+def array(type_, name, values, per_line, format_):
+	lines = [f"\tstatic constexpr std::array<{type_}, {len(values)}> {name}{{{{"]
+	for i in range(0, len(values), per_line):
+		lines.append("\t\t" + " ".join(format_(value) + "," for value in values[i:i + per_line]))
+	lines.append("\t}};")
+	return lines
+
+
+def main():
+	parser = argparse.ArgumentParser(description="Generate a perfect hash table of allowed USB devices")
+	parser.add_argument("--name", default="AllowedUSBDevices", help="name of the generated struct")
+	parser.add_argument("input")
+	parser.add_argument("output")
+	args = parser.parse_args()
+
+	entries = parse(args.input)
+	table, displacements = build(entries)
+	pid_masks = sorted({pid_mask for (_, _, pid_mask) in entries}, reverse=True)
+
+	lines = [
+		f"/* Generated by usb-vid-pid.py from {args.input.split('/')[-1]}, do not edit */",
+		"#pragma once",
+		"",
+		"/* Include usb-vid-pid.h first */",
+		"#include <array>",
+		"#include <cstdint>",
+		"",
+		"namespace hid_identify {",
+		"",
+		f"struct {args.name} {{",
+	]
+	lines += array("uint16_t", "PID_MASKS", pid_masks or [0xFFFF], 8, lambda value: f"0x{value:04X}")
+	lines += array("uint16_t", "DISPLACEMENTS", displacements, 8, lambda value: f"0x{value:04X}")
+	lines += array("uint64_t", "KEYS", table, 4, lambda value: f"0x{value:016X}")
+	lines += array("USBDevice", "DEVICES", entries, 1,
+		lambda entry: "{{ 0x{:04X}, 0x{:04X}, 0x{:04X} }}".format(*entry))
+	lines += [
+		"};",
+		"",
+		"} // namespace hid_identify",
+		"",
+	]
+
+	with open(args.output, "w") as f:
+		f.write("\n".join(lines))
+
+
+if __name__ == "__main__":
+	main()
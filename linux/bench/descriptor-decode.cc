@@ -0,0 +1,190 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+/*
+ * Compare the throughput of the original (switch based) report descriptor
+ * parser and the current (table driven) one, in MB/s of report descriptor,
+ * printing a JSON object on each line for every report descriptor and parser.
+ *
+ * Both parsers must find the same QMK raw HID interface in the existing
+ * report descriptors. Report descriptors that need global items to persist
+ * between main items or Push/Pop are only supported by the current parser.
+ *
+ * Usage: descriptor-decode [-n <runs>]
+ */
+#include <sysexits.h>
+#include <unistd.h>
+
+#include <linux/hid.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "../../common/hid-device.h"
+#include "../../common/types.h"
+#include "../hid-report-desc.h"
+#include "descriptors.h"
+#include "hid-report-desc-hidapi.h"
+#include "results.h"
+
+using namespace hid_identify;
+
+static constexpr unsigned int ATTEMPTS = 5;
+
+/* Parse every usage pair, returning the report count of the first QMK raw HID interface */
+static uint32_t parse_hidapi(const std::vector<uint8_t> &descriptor) {
+	HIDReports reports;
+	uint32_t report_count = 0;
+	unsigned int pos = 0;
+
+	while (hidapi::get_next_hid_usage(descriptor.data(), descriptor.size(), &pos, reports) == 0) {
+		if (report_count == 0) {
+			report_count = HIDDevice::raw_report_count(reports, 0);
+		}
+		reports.pop_back();
+	}
+
+	return report_count;
+}
+
+static uint32_t parse_table(const std::vector<uint8_t> &descriptor) {
+	HIDReportParser parser{descriptor.data(), descriptor.size()};
+	HIDReports reports;
+	uint32_t report_count = 0;
+
+	while (parser.next(reports) == 0) {
+		if (report_count == 0) {
+			report_count = HIDDevice::raw_report_count(reports, 0);
+		}
+		reports.pop_back();
+	}
+
+	return report_count;
+}
+
+int main(int argc, char *argv[]) {
+	unsigned long runs = 20000;
+	int opt;
+
+	while ((opt = ::getopt(argc, argv, "n:")) != -1) {
+		switch (opt) {
+		case 'n':
+			runs = std::strtoul(optarg, nullptr, 10);
+			break;
+
+		default:
+			std::cerr << "Usage: " << argv[0] << " [-n <runs>]" << std::endl;
+			return EX_USAGE;
+		}
+	}
+
+	if (optind != argc || runs == 0) {
+		std::cerr << "Usage: " << argv[0] << " [-n <runs>]" << std::endl;
+		return EX_USAGE;
+	}
+
+	const auto composite = concat({NKRO_KEYBOARD, MOUSE, SYSTEM_CONTROL, CONSUMER, RAW_HID});
+	std::vector<uint8_t> large;
+
+	while (large.size() + composite.size() <= HID_MAX_DESCRIPTOR_SIZE) {
+		large.insert(large.end(), composite.begin(), composite.end());
+	}
+
+	struct Descriptor {
+		const char *name;
+		std::vector<uint8_t> value;
+		bool raw; /* Has a QMK raw HID interface */
+		bool same; /* Both parsers should have the same result */
+	};
+	const std::vector<Descriptor> descriptors{
+		{"keyboard", KEYBOARD, false, true},
+		{"raw", RAW_HID, true, true},
+		{"keyboard+raw", concat({KEYBOARD, RAW_HID}), true, true},
+		{"composite", composite, true, true},
+		{"composite-raw", concat({NKRO_KEYBOARD, MOUSE, SYSTEM_CONTROL, CONSUMER}), false, true},
+		{"large", large, true, true},
+		{"raw-compact", RAW_HID_COMPACT, true, false},
+		{"raw-push-pop", RAW_HID_PUSH_POP, true, false},
+	};
+
+	struct Method {
+		const char *name;
+		uint32_t (*parse)(const std::vector<uint8_t> &descriptor);
+	};
+	const std::vector<Method> methods{
+		{"hidapi", parse_hidapi},
+		{"table", parse_table},
+	};
+
+	int ret = 0;
+
+	for (const auto& descriptor : descriptors) {
+		std::vector<uint32_t> results;
+		std::vector<double> speeds;
+
+		for (const auto& method : methods) {
+			volatile uint32_t report_count = 0;
+			double best = 0;
+
+			/* Use the best of several attempts to reduce noise */
+			for (unsigned int attempt = 0; attempt < ATTEMPTS; attempt++) {
+				auto start = std::chrono::steady_clock::now();
+
+				for (unsigned long i = 0; i < runs; i++) {
+					report_count = method.parse(descriptor.value);
+				}
+
+				std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+				best = std::max(best, descriptor.value.size() * runs / elapsed.count() / 1000000);
+			}
+
+			results.push_back(static_cast<uint32_t>(report_count));
+			speeds.push_back(best);
+		}
+
+		bool ok = true;
+
+		if (descriptor.same && results.front() != results.back()) {
+			std::cerr << descriptor.name << ": different results" << std::endl;
+			ok = false;
+		} else if ((results.back() > 0) != descriptor.raw) {
+			std::cerr << descriptor.name << ": wrong result" << std::endl;
+			ok = false;
+		}
+
+		for (size_t i = 0; i < methods.size(); i++) {
+			std::cout << JSONResult{}
+				.field("benchmark", descriptor.name)
+				.field("method", methods[i].name)
+				.field("bytes", descriptor.value.size())
+				.field("report_count", results[i])
+				.field("mb_per_sec", speeds[i], 1)
+				.field("ok", ok) << std::endl;
+		}
+
+		if (!ok) {
+			ret = EX_SOFTWARE;
+		}
+	}
+
+	return ret;
+}
@@ -0,0 +1,305 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+/*
+ * Compare the time taken to find the QMK raw HID interface in a report
+ * descriptor by parsing every usage pair, by stopping at the first raw HID
+ * usage pair (skipping over collections for other usage pages) or by first
+ * checking that the raw HID usage page is present at all.
+ *
+ * The results of all methods are also compared for randomly modified
+ * copies of each report descriptor, failing if there are any differences.
+ * Every implementation of the usage page check is compared with the scalar
+ * version on random data with the usage page at every position.
+ *
+ * The results for each report descriptor and method (and the usage page
+ * check) are printed as a JSON object on each line.
+ *
+ * Usage: descriptor-scan [-n <runs>]
+ */
+#include <sysexits.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../../common/hid-device.h"
+#include "../../common/types.h"
+#include "../hid-report-desc.h"
+#include "../report-desc-scan.h"
+#include "descriptors.h"
+#include "results.h"
+
+using namespace hid_identify;
+
+/*
+ * The result is the report count of the QMK raw HID interface (or 0), which
+ * is all that matters when identifying a device. The reason for not finding
+ * one (malformed or missing) can differ because the early exit methods don't
+ * look at the rest of the report descriptor.
+ */
+
+/* Parse every usage pair, looking for the QMK raw HID interface */
+static uint32_t scan_full(const std::vector<uint8_t> &descriptor) {
+	HIDReportParser parser{descriptor.data(), descriptor.size()};
+	HIDReports reports;
+	uint32_t report_count = 0;
+	int ret;
+
+	do {
+		ret = parser.next(reports);
+		if (ret == 0) {
+			if (report_count == 0) {
+				report_count = HIDDevice::raw_report_count(reports, 0);
+			}
+
+			reports.pop_back();
+		}
+	} while (ret == 0);
+
+	return report_count;
+}
+
+/* Stop at the first QMK raw HID interface */
+static uint32_t scan_early_exit(const std::vector<uint8_t> &descriptor) {
+	HIDReportParser parser{descriptor.data(), descriptor.size()};
+	HIDReports reports;
+	int ret;
+
+	do {
+		ret = parser.find_next(HIDDevice::RAW_USAGE_PAGE, reports);
+		if (ret == 0) {
+			uint32_t report_count = HIDDevice::raw_report_count(reports, 0);
+
+			if (report_count > 0) {
+				return report_count;
+			}
+
+			reports.pop_back();
+		}
+	} while (ret == 0);
+
+	return 0;
+}
+
+/* Check that the raw HID usage page is present before stopping at the first interface */
+static uint32_t scan_pre_scan(const std::vector<uint8_t> &descriptor) {
+	if (!find_raw_usage_page(descriptor.data(), descriptor.size())) {
+		return 0;
+	}
+
+	return scan_early_exit(descriptor);
+}
+
+struct Implementation {
+	const char *name;
+	bool (*find)(const uint8_t *report_descriptor, size_t size);
+};
+
+static std::vector<Implementation> implementations() {
+	std::vector<Implementation> values{{"scalar", find_raw_usage_page_scalar}};
+
+#ifdef HAVE_FIND_RAW_USAGE_PAGE_SSE2
+	values.push_back({"sse2", find_raw_usage_page_sse2});
+#endif
+#ifdef HAVE_FIND_RAW_USAGE_PAGE_AVX2
+	if (find_raw_usage_page_avx2_supported()) {
+		values.push_back({"avx2", find_raw_usage_page_avx2});
+	}
+#endif
+
+	return values;
+}
+
+/*
+ * Compare every implementation of the usage page check with the scalar
+ * version, for random data of every length up to max_size with and without
+ * the usage page at every position.
+ */
+static unsigned long compare_implementations(std::mt19937 &rng, size_t max_size) {
+	const auto values = implementations();
+	unsigned long differences = 0;
+
+	for (size_t size = 0; size <= max_size; size++) {
+		std::vector<uint8_t> data(size);
+
+		for (size_t pos = 0; pos <= size; pos++) {
+			for (auto& value : data) {
+				/* Avoid matching by chance so that the position is tested */
+				value = rng() % 0x60;
+			}
+
+			if (pos + 3 <= size) {
+				data[pos] = rng() % 2 ? 0x06 : 0x07;
+				data[pos + 1] = HIDDevice::RAW_USAGE_PAGE & 0xFF;
+				data[pos + 2] = HIDDevice::RAW_USAGE_PAGE >> 8;
+			}
+
+			bool expected = find_raw_usage_page_scalar(data.data(), data.size());
+
+			if (expected != (pos + 3 <= size)) {
+				differences++;
+			}
+
+			for (const auto& value : values) {
+				if (value.find(data.data(), data.size()) != expected) {
+					differences++;
+				}
+			}
+		}
+	}
+
+	return differences;
+}
+
+/* Compare the results of all methods for random modifications of a descriptor */
+static unsigned long compare(const std::vector<uint8_t> &descriptor, std::mt19937 &rng, unsigned long runs) {
+	unsigned long differences = 0;
+
+	for (unsigned long i = 0; i < runs; i++) {
+		std::vector<uint8_t> modified = descriptor;
+		unsigned int changes = 1 + rng() % 4;
+
+		for (unsigned int j = 0; j < changes; j++) {
+			modified[rng() % modified.size()] = rng();
+		}
+
+		if (rng() % 4 == 0) {
+			modified.resize(rng() % modified.size());
+		}
+
+		uint32_t expected = scan_full(modified);
+
+		if (expected != scan_early_exit(modified)
+				|| expected != scan_pre_scan(modified)) {
+			differences++;
+		}
+	}
+
+	return differences;
+}
+
+int main(int argc, char *argv[]) {
+	unsigned long runs = 100000;
+	int opt;
+
+	while ((opt = ::getopt(argc, argv, "n:")) != -1) {
+		switch (opt) {
+		case 'n':
+			runs = std::strtoul(optarg, nullptr, 10);
+			break;
+
+		default:
+			std::cerr << "Usage: " << argv[0] << " [-n <runs>]" << std::endl;
+			return EX_USAGE;
+		}
+	}
+
+	if (optind != argc || runs == 0) {
+		std::cerr << "Usage: " << argv[0] << " [-n <runs>]" << std::endl;
+		return EX_USAGE;
+	}
+
+	struct Descriptor {
+		const char *name;
+		std::vector<uint8_t> value;
+	};
+	std::vector<Descriptor> descriptors{
+		{"keyboard", KEYBOARD},
+		{"raw", RAW_HID},
+		{"keyboard+raw", concat({KEYBOARD, RAW_HID})},
+		{"composite", concat({NKRO_KEYBOARD, MOUSE, SYSTEM_CONTROL, CONSUMER, RAW_HID})},
+		{"composite-raw", concat({NKRO_KEYBOARD, MOUSE, SYSTEM_CONTROL, CONSUMER})},
+	};
+
+	struct Method {
+		const char *name;
+		uint32_t (*scan)(const std::vector<uint8_t> &descriptor);
+	};
+	const std::vector<Method> methods{
+		{"full", scan_full},
+		{"early-exit", scan_early_exit},
+		{"pre-scan", scan_pre_scan},
+	};
+
+	std::mt19937 rng{1};
+	int ret = 0;
+
+	for (const auto& descriptor : descriptors) {
+		uint32_t expected = scan_full(descriptor.value);
+		std::vector<uint32_t> results;
+		std::vector<double> times;
+
+		for (const auto& method : methods) {
+			volatile uint32_t report_count = 0;
+			auto start = std::chrono::steady_clock::now();
+
+			for (unsigned long i = 0; i < runs; i++) {
+				report_count = method.scan(descriptor.value);
+			}
+
+			std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+			results.push_back(static_cast<uint32_t>(report_count));
+			times.push_back(elapsed.count() / runs);
+		}
+
+		/* Randomly modified copies, which must have the same result with every method */
+		unsigned long differences = compare(descriptor.value, rng, runs);
+
+		for (size_t i = 0; i < methods.size(); i++) {
+			bool ok = results[i] == expected && differences == 0;
+
+			std::cout << JSONResult{}
+				.field("benchmark", descriptor.name)
+				.field("method", methods[i].name)
+				.field("bytes", descriptor.value.size())
+				.field("report_count", results[i])
+				.field("ns_per_op", times[i], 1)
+				.field("differences", differences)
+				.field("ok", ok) << std::endl;
+
+			if (!ok) {
+				ret = EX_SOFTWARE;
+			}
+		}
+	}
+
+	unsigned long differences = compare_implementations(rng, 256);
+	std::string names;
+
+	for (const auto& value : implementations()) {
+		names += names.empty() ? value.name : std::string{","} + value.name;
+	}
+
+	std::cout << JSONResult{}
+		.field("benchmark", "usage-page-check")
+		.field("implementations", names)
+		.field("differences", differences)
+		.field("ok", differences == 0) << std::endl;
+
+	if (differences > 0) {
+		ret = EX_SOFTWARE;
+	}
+
+	return ret;
+}
@@ -0,0 +1,118 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+/* Report descriptors used by the benchmarks */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+#include "../../common/types.h"
+#include "../hid-report-desc.h"
+
+inline std::vector<uint8_t> concat(std::initializer_list<std::vector<uint8_t>> parts) {
+	std::vector<uint8_t> descriptor;
+
+	for (const auto& part : parts) {
+		descriptor.insert(descriptor.end(), part.begin(), part.end());
+	}
+
+	return descriptor;
+}
+
+/* Parse all of the reports in a report descriptor (for MockHIDDevice) */
+inline hid_identify::Rejection parse_reports(const uint8_t *report_descriptor, size_t size,
+		hid_identify::HIDReports &reports) {
+	hid_identify::HIDReportParser parser{report_descriptor, size};
+	int ret;
+
+	do {
+		ret = parser.next(reports);
+		if (ret == -1) {
+			return hid_identify::Rejection::MALFORMED_HID_REPORT_DESCRIPTOR;
+		}
+	} while (ret != 1);
+
+	return hid_identify::Rejection::NONE;
+}
+
+static const std::vector<uint8_t> KEYBOARD{
+	0x05, 0x01, 0x09, 0x06, 0xA1, 0x01,
+	0x05, 0x07, 0x19, 0xE0, 0x29, 0xE7, 0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x08, 0x81, 0x02,
+	0x95, 0x01, 0x75, 0x08, 0x81, 0x01,
+	0x05, 0x08, 0x19, 0x01, 0x29, 0x05, 0x95, 0x05, 0x75, 0x01, 0x91, 0x02, 0x95, 0x01, 0x75, 0x03, 0x91, 0x01,
+	0x05, 0x07, 0x19, 0x00, 0x2A, 0xFF, 0x00, 0x15, 0x00, 0x26, 0xFF, 0x00, 0x95, 0x06, 0x75, 0x08, 0x81, 0x00,
+	0xC0,
+};
+
+static const std::vector<uint8_t> NKRO_KEYBOARD{
+	0x05, 0x01, 0x09, 0x06, 0xA1, 0x01, 0x85, 0x06,
+	0x05, 0x07, 0x19, 0xE0, 0x29, 0xE7, 0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x08, 0x81, 0x02,
+	0x05, 0x07, 0x19, 0x00, 0x29, 0xEF, 0x15, 0x00, 0x25, 0x01, 0x95, 0xF0, 0x75, 0x01, 0x81, 0x02,
+	0x05, 0x08, 0x19, 0x01, 0x29, 0x05, 0x95, 0x05, 0x75, 0x01, 0x91, 0x02, 0x95, 0x01, 0x75, 0x03, 0x91, 0x01,
+	0xC0,
+};
+
+static const std::vector<uint8_t> MOUSE{
+	0x05, 0x01, 0x09, 0x02, 0xA1, 0x01, 0x85, 0x04, 0x09, 0x01, 0xA1, 0x00,
+	0x05, 0x09, 0x19, 0x01, 0x29, 0x08, 0x15, 0x00, 0x25, 0x01, 0x95, 0x08, 0x75, 0x01, 0x81, 0x02,
+	0x05, 0x01, 0x09, 0x30, 0x09, 0x31, 0x15, 0x81, 0x25, 0x7F, 0x95, 0x02, 0x75, 0x08, 0x81, 0x06,
+	0x09, 0x38, 0x15, 0x81, 0x25, 0x7F, 0x95, 0x01, 0x75, 0x08, 0x81, 0x06,
+	0x05, 0x0C, 0x0A, 0x38, 0x02, 0x15, 0x81, 0x25, 0x7F, 0x95, 0x01, 0x75, 0x08, 0x81, 0x06,
+	0xC0, 0xC0,
+};
+
+static const std::vector<uint8_t> SYSTEM_CONTROL{
+	0x05, 0x01, 0x09, 0x80, 0xA1, 0x01, 0x85, 0x02,
+	0x19, 0x01, 0x2A, 0xB7, 0x00, 0x15, 0x01, 0x26, 0xB7, 0x00, 0x95, 0x01, 0x75, 0x10, 0x81, 0x00,
+	0xC0,
+};
+
+static const std::vector<uint8_t> CONSUMER{
+	0x05, 0x0C, 0x09, 0x01, 0xA1, 0x01, 0x85, 0x03,
+	0x19, 0x01, 0x2A, 0xA0, 0x02, 0x15, 0x01, 0x26, 0xA0, 0x02, 0x95, 0x01, 0x75, 0x10, 0x81, 0x00,
+	0xC0,
+};
+
+static const std::vector<uint8_t> RAW_HID{
+	0x06, 0x60, 0xFF, 0x09, 0x61, 0xA1, 0x01,
+	0x09, 0x62, 0x15, 0x00, 0x26, 0xFF, 0x00, 0x95, 0x20, 0x75, 0x08, 0x81, 0x02,
+	0x09, 0x63, 0x15, 0x00, 0x26, 0xFF, 0x00, 0x95, 0x20, 0x75, 0x08, 0x91, 0x02,
+	0xC0,
+};
+
+/* QMK raw HID interface relying on global items from the Input item */
+static const std::vector<uint8_t> RAW_HID_COMPACT{
+	0x06, 0x60, 0xFF, 0x09, 0x61, 0xA1, 0x01,
+	0x09, 0x62, 0x15, 0x00, 0x26, 0xFF, 0x00, 0x95, 0x20, 0x75, 0x08, 0x81, 0x02,
+	0x09, 0x63, 0x91, 0x02,
+	0xC0,
+};
+
+/* QMK raw HID interface with a usage page restored by Pop after a keyboard */
+static const std::vector<uint8_t> RAW_HID_PUSH_POP = concat({
+	{0x06, 0x60, 0xFF, 0xA4},
+	KEYBOARD,
+	{
+		0xB4, 0x09, 0x61, 0xA1, 0x01,
+		0x09, 0x62, 0x15, 0x00, 0x26, 0xFF, 0x00, 0x95, 0x20, 0x75, 0x08, 0x81, 0x02,
+		0x09, 0x63, 0x15, 0x00, 0x26, 0xFF, 0x00, 0x95, 0x20, 0x75, 0x08, 0x91, 0x02,
+		0xC0,
+	},
+});
@@ -0,0 +1,176 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+/*
+ * Count the memory allocations made when identifying devices, failing if
+ * there are any, and print the result for each device as a JSON object on
+ * each line. Each device is identified once before counting so that
+ * one-time initialisation is excluded.
+ *
+ * Without any hidraw devices an in-memory device is identified instead, with
+ * a report descriptor containing a keyboard and a QMK raw HID interface that
+ * is parsed every time.
+ *
+ * Only allocations made with operator new are counted.
+ *
+ * Usage: identify-allocations [-n <runs>] [<hidraw device>...]
+ */
+#include <sysexits.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "../../common/hid-device.h"
+#include "../../common/mock-hid-device.h"
+#include "../../common/types.h"
+#include "../hid-identify.h"
+#include "descriptors.h"
+#include "results.h"
+
+using namespace hid_identify;
+
+static std::atomic<bool> counting{false};
+static std::atomic<unsigned long> allocations{0};
+
+/* Not inlined to avoid false positive mismatched new/delete warnings */
+__attribute__((noinline)) void *operator new(size_t size) {
+	if (counting) {
+		allocations++;
+	}
+
+	void *ptr = std::malloc(size ? size : 1);
+	if (ptr == nullptr) {
+		throw std::bad_alloc{};
+	}
+	return ptr;
+}
+
+__attribute__((noinline)) void operator delete(void *ptr) noexcept {
+	std::free(ptr);
+}
+
+__attribute__((noinline)) void operator delete(void *ptr, size_t size __attribute__((unused))) noexcept {
+	std::free(ptr);
+}
+
+/* Returns the number of allocations made by each identify */
+static double count_allocations(const std::function<std::unique_ptr<HIDDevice>()> &create,
+		unsigned long runs) {
+	unsigned long total = 0;
+
+	for (unsigned long i = 0; i <= runs; i++) {
+		auto device = create();
+		Rejection rejection;
+
+		allocations = 0;
+		counting = true;
+
+		try {
+			rejection = device->identify();
+		} catch (...) {
+			counting = false;
+			throw;
+		}
+
+		counting = false;
+
+		if (rejection != Rejection::NONE) {
+			throw UnsupportedDevice{};
+		}
+
+		/* The first run is only for initialisation */
+		if (i > 0) {
+			total += allocations;
+		}
+	}
+
+	return (double)total / runs;
+}
+
+int main(int argc, char *argv[]) {
+	unsigned long runs = 100;
+	int opt;
+
+	while ((opt = ::getopt(argc, argv, "n:")) != -1) {
+		switch (opt) {
+		case 'n':
+			runs = std::strtoul(optarg, nullptr, 10);
+			break;
+
+		default:
+			std::cerr << "Usage: " << argv[0] << " [-n <runs>] [<hidraw device>...]" << std::endl;
+			return EX_USAGE;
+		}
+	}
+
+	if (runs == 0) {
+		std::cerr << "Usage: " << argv[0] << " [-n <runs>] [<hidraw device>...]" << std::endl;
+		return EX_USAGE;
+	}
+
+	std::vector<std::pair<std::string, std::function<std::unique_ptr<HIDDevice>()>>> devices;
+
+	if (optind == argc) {
+		devices.emplace_back("mock", [] {
+			static const std::vector<uint8_t> descriptor = concat({KEYBOARD, RAW_HID});
+
+			return std::make_unique<MockHIDDevice>(USBDeviceInfo{0x16C0, 0x27DB, 1},
+				descriptor, parse_reports);
+		});
+	}
+
+	for (int i = optind; i < argc; i++) {
+		std::string pathname = argv[i];
+
+		devices.emplace_back(pathname, [pathname] { return std::make_unique<LinuxHIDDevice>(pathname); });
+	}
+
+	int ret = 0;
+
+	for (auto& device : devices) {
+		double count;
+
+		try {
+			count = count_allocations(device.second, runs);
+		} catch (const Exception&) {
+			std::cerr << device.first << ": identify failed" << std::endl;
+			ret = EX_UNAVAILABLE;
+			continue;
+		}
+
+		std::cout << JSONResult{}
+			.field("benchmark", device.first)
+			.field("runs", runs)
+			.field("allocations_per_op", count)
+			.field("ok", count == 0) << std::endl;
+
+		if (count > 0) {
+			ret = EX_SOFTWARE;
+		}
+	}
+
+	return ret;
+}
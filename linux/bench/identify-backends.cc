@@ -0,0 +1,220 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+/*
+ * Compare the time taken and number of system calls made when identifying a
+ * set of devices using each of the available methods, printing a JSON object
+ * on each line for every method.
+ *
+ * Without any hidraw devices every allowed device in sysfs is identified, and
+ * the benchmark is skipped if there aren't any.
+ *
+ * Usage: identify-backends [-n <runs>] [<hidraw device>...]
+ */
+#include <sys/ptrace.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <sysexits.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../../common/types.h"
+#include "../hid-identify.h"
+#include "../hid-workers.h"
+#include "../sysfs.h"
+#ifdef HAVE_LIBURING
+#	include "../hid-uring.h"
+#endif
+#include "results.h"
+
+using namespace hid_identify;
+
+struct Backend {
+	std::string name;
+	std::function<void(const std::vector<std::string>&)> run;
+};
+
+/*
+ * Count the system calls made by a function, by running it in a child
+ * process that is traced. Returns -1 if tracing isn't possible.
+ */
+static long count_syscalls(const std::function<void()> &func) {
+	pid_t pid = ::fork();
+	if (pid < 0) {
+		return -1;
+	} else if (pid == 0) {
+		if (::ptrace(PTRACE_TRACEME, 0, nullptr, nullptr) < 0) {
+			::_exit(EX_OSERR);
+		}
+
+		::raise(SIGSTOP);
+		func();
+		::_exit(0);
+	}
+
+	int status = 0;
+	if (::waitpid(pid, &status, 0) < 0 || !WIFSTOPPED(status)) {
+		return -1;
+	}
+
+	::ptrace(PTRACE_SETOPTIONS, pid, nullptr, PTRACE_O_TRACESYSGOOD | PTRACE_O_EXITKILL);
+
+	long count = 0;
+	bool entry = true;
+	int sig = 0;
+
+	while (1) {
+		if (::ptrace(PTRACE_SYSCALL, pid, nullptr, sig) < 0) {
+			return -1;
+		}
+
+		if (::waitpid(pid, &status, 0) < 0) {
+			return -1;
+		}
+
+		sig = 0;
+		if (WIFEXITED(status) || WIFSIGNALED(status)) {
+			break;
+		} else if (WSTOPSIG(status) == (SIGTRAP | 0x80)) {
+			if (entry) {
+				count++;
+			}
+			entry = !entry;
+		} else {
+			sig = WSTOPSIG(status);
+		}
+	}
+
+	return (WIFEXITED(status) && WEXITSTATUS(status) == 0) ? count : -1;
+}
+
+int main(int argc, char *argv[]) {
+	unsigned long runs = 10;
+	int opt;
+
+	while ((opt = ::getopt(argc, argv, "n:")) != -1) {
+		switch (opt) {
+		case 'n':
+			runs = std::strtoul(optarg, nullptr, 10);
+			break;
+
+		default:
+			std::cerr << "Usage: " << argv[0] << " [-n <runs>] [<hidraw device>...]" << std::endl;
+			return EX_USAGE;
+		}
+	}
+
+	if (runs == 0) {
+		std::cerr << "Usage: " << argv[0] << " [-n <runs>] [<hidraw device>...]" << std::endl;
+		return EX_USAGE;
+	}
+
+	std::vector<std::string> devices{&argv[optind], &argv[argc]};
+
+	if (devices.empty()) {
+		for (const auto& device : HIDRawSysfs::instance().allowed_devices()) {
+			devices.push_back("/dev/" + device.name);
+		}
+
+		if (devices.empty()) {
+			std::cerr << "No allowed hidraw devices" << std::endl;
+			return SKIPPED;
+		}
+	}
+	std::vector<Backend> backends{
+		{"syscall", [] (const std::vector<std::string> &pathnames) {
+			for (const auto& pathname : pathnames) {
+				HID_TRY {
+					(void)LinuxHIDDevice(pathname).identify();
+				} HID_CATCH(const Exception&) {
+					/* Failures are logged */
+				}
+			}
+		}},
+		{"workers", [] (const std::vector<std::string> &pathnames) {
+			LinuxHIDWorkers workers{static_cast<unsigned int>(pathnames.size())};
+
+			for (const auto& pathname : pathnames) {
+				workers.add(pathname);
+			}
+
+			workers.run();
+		}},
+	};
+
+#ifdef HAVE_LIBURING
+	if (LinuxHIDUring{}) {
+		backends.push_back({"io_uring", [] (const std::vector<std::string> &pathnames) {
+			LinuxHIDUring uring;
+
+			for (const auto& pathname : pathnames) {
+				uring.add(pathname);
+			}
+
+			uring.run();
+		}});
+	} else {
+		std::cerr << "io_uring is not available" << std::endl;
+	}
+#endif
+
+	long baseline = count_syscalls([] {});
+	std::vector<std::pair<double, long>> results;
+
+	for (const auto& backend : backends) {
+		auto start = std::chrono::steady_clock::now();
+
+		for (unsigned long i = 0; i < runs; i++) {
+			backend.run(devices);
+		}
+
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		long syscalls = count_syscalls([&] { backend.run(devices); });
+
+		if (syscalls >= 0 && baseline >= 0) {
+			syscalls -= baseline;
+		} else {
+			syscalls = -1;
+		}
+
+		results.emplace_back(elapsed.count() / runs, syscalls);
+	}
+
+	for (size_t i = 0; i < backends.size(); i++) {
+		JSONResult result;
+
+		result.field("benchmark", backends[i].name)
+			.field("devices", devices.size())
+			.field("runs", runs)
+			.field("ms_per_run", results[i].first);
+
+		if (results[i].second >= 0) {
+			result.field("syscalls_per_run", results[i].second);
+		}
+
+		std::cout << result.field("ok", true) << std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,296 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+/*
+ * Measure each stage of identifying a device using an in-memory device,
+ * printing one JSON object per line for each benchmark:
+ *
+ *   allowlist   Check if USB devices are allowed
+ *   descriptor  Parse a composite report descriptor
+ *   validation  Find the QMK raw HID interface in parsed reports
+ *   overflow    Reject a device with more reports than can be stored
+ *   identify    Identify a device, sending the report to it
+ *   stages      Identify a device, measuring the time taken by each stage
+ *
+ * The report sent by the identify benchmark is checked, failing if it is
+ * incorrect. The overflow benchmark fails if the device isn't rejected
+ * because its reports don't fit. The stages benchmark fails if the stages
+ * that the in-memory device goes through aren't measured, or if any other
+ * stages are.
+ *
+ * Usage: identify-pipeline [-n <runs>] [<benchmark>...]
+ */
+#include <sysexits.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "../../common/hid-device.h"
+#include "../../common/mock-hid-device.h"
+#include "../../common/types.h"
+#include "../hid-report-desc.h"
+#include "descriptors.h"
+#include "results.h"
+
+using namespace hid_identify;
+
+static constexpr unsigned int ATTEMPTS = 5;
+
+static volatile uint32_t sink;
+
+static const std::array<USBDeviceInfo, 4> DEVICES{{
+	{0x16C0, 0x27DB, 1},
+	{0x16C0, 0x27DB, 0},
+	{0x046D, 0xC52B, 1},
+	{0xFEED, 0x6060, 1},
+}};
+
+static const std::vector<uint8_t> COMPOSITE = concat({NKRO_KEYBOARD, MOUSE, SYSTEM_CONTROL, CONSUMER, RAW_HID});
+
+static bool bench_allowlist(unsigned long runs) {
+	uint32_t allowed = 0;
+
+	for (unsigned long i = 0; i < runs; i++) {
+		allowed += HIDDevice::device_allowed(DEVICES[i % DEVICES.size()]);
+	}
+
+	sink = allowed;
+	return true;
+}
+
+static bool bench_descriptor(unsigned long runs) {
+	uint32_t report_count = 0;
+
+	for (unsigned long i = 0; i < runs; i++) {
+		HIDReportParser parser{COMPOSITE.data(), COMPOSITE.size()};
+		HIDReports reports;
+
+		report_count = 0;
+		while (parser.find_next(HIDDevice::RAW_USAGE_PAGE, reports) == 0) {
+			report_count = HIDDevice::raw_report_count(reports, reports.size() - 1);
+			if (report_count > 0) {
+				break;
+			}
+			reports.pop_back();
+		}
+	}
+
+	sink = report_count;
+	return report_count > 0;
+}
+
+static HIDReports keyboard_and_raw_reports() {
+	HIDReportParser parser{KEYBOARD.data(), KEYBOARD.size()};
+	HIDReports reports;
+
+	while (parser.next(reports) == 0) {
+	}
+
+	HIDDevice::add_raw_report(reports, 32);
+	return reports;
+}
+
+static bool bench_validation(unsigned long runs) {
+	const HIDReports reports = keyboard_and_raw_reports();
+	uint32_t report_count = 0;
+
+	for (unsigned long i = 0; i < runs; i++) {
+		report_count = HIDDevice::raw_report_count(reports);
+		sink = report_count;
+	}
+
+	return report_count == 32;
+}
+
+/* All of the reports in the composite report descriptor, one more than can be stored */
+static HIDReports composite_reports() {
+	HIDReportParser parser{COMPOSITE.data(), COMPOSITE.size()};
+	HIDReports reports;
+
+	while (parser.next(reports) == 0) {
+	}
+
+	return reports;
+}
+
+static bool bench_overflow(unsigned long runs) {
+	MockHIDDevice device{DEVICES[0], composite_reports()};
+
+	for (unsigned long i = 0; i < runs; i++) {
+		if (device.identify() != Rejection::UNSUPPORTED_HID_REPORT_DESCRIPTOR) {
+			return false;
+		}
+
+		device.close();
+	}
+
+	return device.frames() == 0;
+}
+
+static bool bench_identify(unsigned long runs) {
+	MockHIDDevice device{DEVICES[0], keyboard_and_raw_reports()};
+	static constexpr std::array<uint8_t, 7> expected{0x00, 0x00, 0x01, 'L', 'N', 'X', 0x00};
+
+	for (unsigned long i = 0; i < runs; i++) {
+		device.clear_frames();
+
+		if (device.identify() != Rejection::NONE) {
+			return false;
+		}
+
+		device.close();
+	}
+
+	return device.frames() == 1
+		&& device.frame_length(0) == 1 + 32
+		&& std::equal(expected.begin(), expected.end(), device.frame(0))
+		&& std::all_of(device.frame(0) + expected.size(),
+			device.frame(0) + device.frame_length(0),
+			[] (uint8_t value) { return value == 0; });
+}
+
+static bool bench_stages(unsigned long runs) {
+	MockHIDDevice device{DEVICES[0], keyboard_and_raw_reports()};
+	HIDDevice::StageTimes times{};
+
+	device.measure_stages(&times);
+
+	for (unsigned long i = 0; i < runs; i++) {
+		device.clear_frames();
+
+		if (device.identify() != Rejection::NONE) {
+			return false;
+		}
+
+		device.close();
+	}
+
+	/* The in-memory device is opened without any ioctls or report descriptor */
+	for (size_t stage = 0; stage < HIDDevice::STAGES; stage++) {
+		switch (static_cast<HIDDevice::Stage>(stage)) {
+		case HIDDevice::Stage::IOCTL:
+		case HIDDevice::Stage::READ_DESCRIPTOR:
+		case HIDDevice::Stage::PARSE_DESCRIPTOR:
+			if (times[stage] != 0) {
+				return false;
+			}
+			break;
+
+		default:
+			if (times[stage] == 0) {
+				return false;
+			}
+			break;
+		}
+	}
+
+	return device.frames() == 1;
+}
+
+int main(int argc, char *argv[]) {
+	unsigned long runs = 0;
+	int opt;
+
+	while ((opt = ::getopt(argc, argv, "n:")) != -1) {
+		switch (opt) {
+		case 'n':
+			runs = std::strtoul(optarg, nullptr, 10);
+			if (runs == 0) {
+				std::cerr << "Usage: " << argv[0] << " [-n <runs>] [<benchmark>...]" << std::endl;
+				return EX_USAGE;
+			}
+			break;
+
+		default:
+			std::cerr << "Usage: " << argv[0] << " [-n <runs>] [<benchmark>...]" << std::endl;
+			return EX_USAGE;
+		}
+	}
+
+	struct Benchmark {
+		const char *name;
+		bool (*run)(unsigned long runs);
+		unsigned long runs;
+	};
+	const std::vector<Benchmark> benchmarks{
+		{"allowlist", bench_allowlist, 10000000},
+		{"descriptor", bench_descriptor, 100000},
+		{"validation", bench_validation, 10000000},
+		{"overflow", bench_overflow, 1000000},
+		{"identify", bench_identify, 1000000},
+		{"stages", bench_stages, 1000000},
+	};
+
+	std::vector<const Benchmark*> selected;
+
+	for (int i = optind; i < argc; i++) {
+		auto it = std::find_if(benchmarks.begin(), benchmarks.end(),
+			[&] (const Benchmark &benchmark) { return !std::strcmp(benchmark.name, argv[i]); });
+
+		if (it == benchmarks.end()) {
+			std::cerr << argv[0] << ": unknown benchmark: " << argv[i] << std::endl;
+			return EX_USAGE;
+		}
+
+		selected.push_back(&*it);
+	}
+
+	if (selected.empty()) {
+		for (const auto& benchmark : benchmarks) {
+			selected.push_back(&benchmark);
+		}
+	}
+
+	int ret = 0;
+
+	for (const auto *benchmark : selected) {
+		unsigned long benchmark_runs = runs ? runs : benchmark->runs;
+		double best = 0;
+		bool ok = true;
+
+		/* Use the best of several attempts to reduce noise */
+		for (unsigned int attempt = 0; attempt < ATTEMPTS; attempt++) {
+			auto start = std::chrono::steady_clock::now();
+
+			ok = benchmark->run(benchmark_runs) && ok;
+
+			std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+			best = attempt == 0 ? elapsed.count() : std::min(best, elapsed.count());
+		}
+
+		if (!ok) {
+			ret = EX_SOFTWARE;
+		}
+
+		std::cout << JSONResult{}
+			.field("benchmark", benchmark->name)
+			.field("runs", benchmark_runs)
+			.field("ns_per_op", best / benchmark_runs)
+			.field("ops_per_sec", benchmark_runs / best * 1e9, 0)
+			.field("ok", ok) << std::endl;
+	}
+
+	return ret;
+}
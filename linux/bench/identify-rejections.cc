@@ -0,0 +1,182 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+/*
+ * Compare the number of devices per second that can be rejected when the
+ * rejection is returned (current) and when it is thrown as an exception and
+ * caught by the caller (as it was previously), printing a JSON object on
+ * each line for every device and method. The speedup is relative to the
+ * first method.
+ *
+ * The exception is thrown from outside HIDDevice::identify() after it has
+ * returned, so the previous cost of unwinding through it is underestimated.
+ *
+ * Usage: identify-rejections [-n <runs>]
+ */
+#include <sysexits.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "../../common/hid-device.h"
+#include "../../common/mock-hid-device.h"
+#include "../../common/types.h"
+#include "../exit-status.h"
+#include "descriptors.h"
+#include "results.h"
+
+using namespace hid_identify;
+
+static constexpr unsigned int ATTEMPTS = 5;
+
+/* Previous behaviour, with the rejection thrown as an exception */
+__attribute__((noinline)) static void identify_throw(HIDDevice &device) {
+	switch (device.identify()) {
+	case Rejection::NONE:
+		break;
+
+	case Rejection::DISALLOWED_USB_DEVICE:
+		throw DisallowedUSBDevice{};
+
+	case Rejection::UNSUPPORTED_HID_REPORT_DESCRIPTOR:
+		throw UnsupportedHIDReportDescriptor{};
+
+	case Rejection::MALFORMED_HID_REPORT_DESCRIPTOR:
+		throw MalformedHIDReportDescriptor{};
+
+	case Rejection::UNSUPPORTED_HID_REPORT_USAGE:
+		throw UnsupportedHIDReportUsage{};
+	}
+}
+
+static int identify_exception(HIDDevice &device) {
+	int status = 0;
+
+	try {
+		identify_throw(device);
+	} catch (const Exception&) {
+		status = exception_exit_status();
+	}
+
+	device.close();
+	return status;
+}
+
+static int identify_result(HIDDevice &device) {
+	int status = rejection_exit_status(device.identify());
+
+	device.close();
+	return status;
+}
+
+int main(int argc, char *argv[]) {
+	unsigned long runs = 100000;
+	int opt;
+
+	while ((opt = ::getopt(argc, argv, "n:")) != -1) {
+		switch (opt) {
+		case 'n':
+			runs = std::strtoul(optarg, nullptr, 10);
+			break;
+
+		default:
+			std::cerr << "Usage: " << argv[0] << " [-n <runs>]" << std::endl;
+			return EX_USAGE;
+		}
+	}
+
+	if (optind != argc || runs == 0) {
+		std::cerr << "Usage: " << argv[0] << " [-n <runs>]" << std::endl;
+		return EX_USAGE;
+	}
+
+	static constexpr USBDeviceInfo ALLOWED{0x16C0, 0x27DB, 1};
+	static constexpr USBDeviceInfo DISALLOWED{0x0001, 0x0001, 1};
+	const std::vector<uint8_t> truncated(RAW_HID.begin(), RAW_HID.end() - 2);
+
+	struct Device {
+		const char *name;
+		USBDeviceInfo device_info;
+		const std::vector<uint8_t> &descriptor;
+		int status;
+	};
+	const std::vector<Device> devices{
+		{"disallowed", DISALLOWED, RAW_HID, EX_UNAVAILABLE},
+		{"keyboard", ALLOWED, KEYBOARD, EX_UNAVAILABLE},
+		{"malformed", ALLOWED, truncated, EX_DATAERR},
+	};
+
+	struct Method {
+		const char *name;
+		int (*identify)(HIDDevice &device);
+	};
+	const std::array<Method, 2> methods{{
+		{"exception", identify_exception},
+		{"result", identify_result},
+	}};
+
+	int ret = 0;
+
+	for (const auto& device : devices) {
+		MockHIDDevice hid_device{device.device_info, device.descriptor, parse_reports};
+		std::vector<double> results;
+
+		for (const auto& method : methods) {
+			int status = 0;
+			double best = 0;
+
+			/* Use the best of several attempts to reduce noise */
+			for (unsigned int attempt = 0; attempt < ATTEMPTS; attempt++) {
+				auto start = std::chrono::steady_clock::now();
+
+				for (unsigned long i = 0; i < runs; i++) {
+					status = method.identify(hid_device);
+				}
+
+				std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+				best = std::max(best, runs / elapsed.count());
+			}
+
+			bool ok = status == device.status;
+
+			if (!ok) {
+				std::cerr << device.name << ": " << method.name
+					<< ": exit status " << status << " != " << device.status << std::endl;
+				ret = EX_SOFTWARE;
+			}
+
+			results.push_back(best);
+			std::cout << JSONResult{}
+				.field("benchmark", device.name)
+				.field("method", method.name)
+				.field("runs", runs)
+				.field("ops_per_sec", best, 0)
+				.field("speedup", best / results.front(), 2)
+				.field("status", status)
+				.field("ok", ok) << std::endl;
+		}
+	}
+
+	return ret;
+}
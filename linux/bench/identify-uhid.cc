@@ -0,0 +1,401 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+/*
+ * Measure the latency from creating virtual QMK keyboards through uhid until
+ * the identify report is received by them, for each way of identifying
+ * devices:
+ *
+ *   exec      Run qmk-hid-identify for each device as soon as it appears,
+ *             in the same way as the udev rules
+ *   identify  Identify each device in this process as soon as it appears
+ *   workers   Identify all of the devices in this process in parallel using
+ *             <jobs> threads after they have all appeared
+ *
+ * The devices have the QMK raw HID report descriptor and an allowed USB
+ * VID/PID. The latency starts when UHID_CREATE2 is written and ends when the
+ * UHID_OUTPUT event with the identify report is read.
+ *
+ * The results are printed as a JSON object on one line.
+ *
+ * This requires access to /dev/uhid and the hidraw devices (usually root),
+ * and is skipped if /dev/uhid can't be opened.
+ *
+ * Usage: identify-uhid [-n <devices>] [-j <jobs>] [-x <qmk-hid-identify>] <mode>
+ */
+#include <sys/epoll.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sysexits.h>
+#include <unistd.h>
+
+#include <linux/input.h>
+#include <linux/uhid.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../common/hid-device.h"
+#include "../../common/types.h"
+#include "../hid-identify.h"
+#include "../hid-workers.h"
+#include "../unique-fd.h"
+#include "descriptors.h"
+#include "results.h"
+
+using namespace hid_identify;
+
+using Clock = std::chrono::steady_clock;
+
+static constexpr uint16_t VENDOR_ID = 0x16C0;
+static constexpr uint16_t PRODUCT_ID = 0x27DB;
+static constexpr std::chrono::seconds TIMEOUT{30};
+
+/* Report count of the RAW_HID report descriptor */
+static constexpr size_t RAW_HID_REPORT_COUNT = 32;
+
+struct VirtualDevice {
+	std::string uniq;
+	unique_fd uhid_fd;
+	std::string pathname; /* hidraw device, when it has appeared */
+	Clock::time_point created;
+	Clock::time_point received;
+	bool started;
+	bool identified;
+	pid_t pid; /* exec mode process */
+};
+
+static bool open_uhid(VirtualDevice &device) {
+	device.uhid_fd = unique_fd(::open("/dev/uhid", O_RDWR | O_CLOEXEC));
+	if (!device.uhid_fd) {
+		std::perror("/dev/uhid");
+		return false;
+	}
+
+	return true;
+}
+
+static bool create_device(VirtualDevice &device) {
+	struct uhid_event ev{};
+
+	ev.type = UHID_CREATE2;
+	std::snprintf(reinterpret_cast<char*>(ev.u.create2.name), sizeof(ev.u.create2.name),
+		"QMK raw HID benchmark");
+	std::snprintf(reinterpret_cast<char*>(ev.u.create2.phys), sizeof(ev.u.create2.phys),
+		"%s", device.uniq.c_str());
+	std::snprintf(reinterpret_cast<char*>(ev.u.create2.uniq), sizeof(ev.u.create2.uniq),
+		"%s", device.uniq.c_str());
+	ev.u.create2.rd_size = RAW_HID.size();
+	ev.u.create2.bus = BUS_USB;
+	ev.u.create2.vendor = VENDOR_ID;
+	ev.u.create2.product = PRODUCT_ID;
+	std::copy(RAW_HID.begin(), RAW_HID.end(), ev.u.create2.rd_data);
+
+	device.created = Clock::now();
+	if (::write(device.uhid_fd.get(), &ev, sizeof(ev)) != sizeof(ev)) {
+		std::perror("write(UHID_CREATE2)");
+		return false;
+	}
+
+	return true;
+}
+
+/* Find the hidraw devices that have appeared for each virtual device */
+static void find_devices(std::vector<VirtualDevice> &devices,
+		std::map<std::string, size_t> &uniqs, std::map<std::string, bool> &seen) {
+	DIR *dir = ::opendir("/sys/class/hidraw");
+	if (dir == nullptr) {
+		return;
+	}
+
+	struct dirent *entry;
+
+	while ((entry = ::readdir(dir)) != nullptr) {
+		std::string name = entry->d_name;
+
+		if (name[0] == '.' || seen.count(name)) {
+			continue;
+		}
+
+		FILE *uevent = std::fopen(("/sys/class/hidraw/" + name + "/device/uevent").c_str(), "re");
+		if (uevent == nullptr) {
+			continue;
+		}
+
+		std::array<char, 256> line;
+		bool found = false;
+
+		while (std::fgets(line.data(), line.size(), uevent) != nullptr) {
+			if (!std::strncmp(line.data(), "HID_UNIQ=", 9)) {
+				std::string uniq = line.data() + 9;
+
+				uniq.erase(uniq.find_last_not_of('\n') + 1);
+
+				auto it = uniqs.find(uniq);
+				if (it != uniqs.end()) {
+					devices[it->second].pathname = "/dev/" + name;
+				}
+
+				found = true;
+				break;
+			}
+		}
+
+		std::fclose(uevent);
+
+		/* Check again later if the uevent wasn't ready yet */
+		if (found) {
+			seen[name] = true;
+		}
+	}
+
+	::closedir(dir);
+}
+
+/* Wait for the identify report to be received by each device */
+static void receive_reports(std::vector<VirtualDevice> &devices, Clock::time_point deadline) {
+	unique_fd epoll_fd{::epoll_create1(EPOLL_CLOEXEC)};
+	size_t pending = devices.size();
+
+	for (size_t i = 0; i < devices.size(); i++) {
+		struct epoll_event event{};
+
+		event.events = EPOLLIN;
+		event.data.u64 = i;
+		::epoll_ctl(epoll_fd.get(), EPOLL_CTL_ADD, devices[i].uhid_fd.get(), &event);
+	}
+
+	const std::array<uint8_t, 7> expected{0x00, 0x00, 0x01, 'L', 'N', 'X', 0x00};
+	std::vector<struct epoll_event> events(64);
+
+	while (pending > 0) {
+		auto timeout_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+			deadline - Clock::now()).count();
+		if (timeout_ms <= 0) {
+			break;
+		}
+
+		int ret = ::epoll_wait(epoll_fd.get(), events.data(), events.size(), timeout_ms);
+		if (ret < 0 && errno != EINTR) {
+			std::perror("epoll_wait");
+			break;
+		}
+
+		for (int i = 0; i < ret; i++) {
+			auto &device = devices[events[i].data.u64];
+			struct uhid_event ev{};
+
+			if (::read(device.uhid_fd.get(), &ev, sizeof(ev)) <= 0 || ev.type != UHID_OUTPUT) {
+				continue;
+			}
+
+			if (!device.identified
+					&& ev.u.output.size == 1 + RAW_HID_REPORT_COUNT
+					&& std::equal(expected.begin(), expected.end(), ev.u.output.data)) {
+				device.received = Clock::now();
+				device.identified = true;
+				pending--;
+			}
+		}
+	}
+}
+
+static double percentile(const std::vector<double> &sorted, double p) {
+	return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+}
+
+static void usage(const char *name) {
+	std::cerr << "Usage: " << name << " [-n <devices>] [-j <jobs>] [-x <qmk-hid-identify>] exec|identify|workers" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+	unsigned long count = 100;
+	unsigned int jobs = 16;
+	const char *program = "qmk-hid-identify";
+	int opt;
+
+	while ((opt = ::getopt(argc, argv, "n:j:x:")) != -1) {
+		switch (opt) {
+		case 'n':
+			count = std::strtoul(optarg, nullptr, 10);
+			break;
+
+		case 'j':
+			jobs = std::strtoul(optarg, nullptr, 10);
+			break;
+
+		case 'x':
+			program = optarg;
+			break;
+
+		default:
+			usage(argv[0]);
+			return EX_USAGE;
+		}
+	}
+
+	if (optind != argc - 1 || count == 0 || jobs == 0) {
+		usage(argv[0]);
+		return EX_USAGE;
+	}
+
+	std::string mode = argv[optind];
+
+	if (mode != "exec" && mode != "identify" && mode != "workers") {
+		usage(argv[0]);
+		return EX_USAGE;
+	}
+
+	std::vector<VirtualDevice> devices(count);
+	std::map<std::string, size_t> uniqs;
+	std::map<std::string, bool> seen;
+
+	for (size_t i = 0; i < devices.size(); i++) {
+		devices[i].uniq = "qmk-hid-identify-bench-" + std::to_string(::getpid()) + "-" + std::to_string(i);
+		uniqs[devices[i].uniq] = i;
+	}
+
+	for (size_t i = 0; i < devices.size(); i++) {
+		if (!open_uhid(devices[i])) {
+			return i == 0 ? SKIPPED : EX_NOINPUT;
+		}
+	}
+
+	/* Existing devices are ignored */
+	find_devices(devices, uniqs, seen);
+
+	auto deadline = Clock::now() + TIMEOUT;
+	std::thread receiver{receive_reports, std::ref(devices), deadline};
+	bool ok = true;
+
+	for (auto& device : devices) {
+		if (!create_device(device)) {
+			ok = false;
+			break;
+		}
+	}
+
+	size_t started = 0;
+	std::vector<std::string> pathnames;
+
+	pathnames.reserve(devices.size());
+
+	while (ok && started < devices.size() && Clock::now() < deadline) {
+		find_devices(devices, uniqs, seen);
+
+		for (auto& device : devices) {
+			if (device.pathname.empty() || device.started) {
+				continue;
+			}
+
+			pathnames.push_back(device.pathname);
+			device.started = true;
+			started++;
+
+			if (mode == "exec") {
+				device.pid = ::fork();
+				if (device.pid == 0) {
+					::execlp(program, program, device.pathname.c_str(), nullptr);
+					::_exit(EX_UNAVAILABLE);
+				} else if (device.pid < 0) {
+					std::perror("fork");
+					device.pid = 0;
+				}
+			} else if (mode == "identify") {
+				try {
+					(void)LinuxHIDDevice(device.pathname).identify();
+				} catch (const Exception&) {
+					/* The report won't be received */
+				}
+			}
+		}
+
+		if (started < devices.size()) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+
+	if (mode == "workers") {
+		LinuxHIDWorkers workers{jobs};
+
+		for (const auto& pathname : pathnames) {
+			workers.add(pathname);
+		}
+
+		try {
+			workers.run();
+		} catch (const Exception&) {
+			ok = false;
+		}
+	}
+
+	receiver.join();
+
+	for (auto& device : devices) {
+		if (device.pid > 0) {
+			::waitpid(device.pid, nullptr, 0);
+		}
+	}
+
+	std::vector<double> latency_ms;
+
+	for (const auto& device : devices) {
+		if (device.identified) {
+			latency_ms.push_back(std::chrono::duration<double, std::milli>(
+				device.received - device.created).count());
+		}
+	}
+
+	std::sort(latency_ms.begin(), latency_ms.end());
+
+	JSONResult result;
+
+	result.field("benchmark", mode)
+		.field("devices", devices.size())
+		.field("identified", latency_ms.size());
+
+	if (!latency_ms.empty()) {
+		result.field("min_ms", latency_ms.front())
+			.field("p50_ms", percentile(latency_ms, 0.5))
+			.field("p99_ms", percentile(latency_ms, 0.99))
+			.field("max_ms", latency_ms.back());
+	}
+
+	std::cout << result.field("ok", ok && latency_ms.size() == count) << std::endl;
+
+	/* Closing uhid destroys the devices */
+	devices.clear();
+
+	if (!ok) {
+		return EX_OSERR;
+	}
+
+	return latency_ms.size() == count ? 0 : EX_SOFTWARE;
+}
@@ -0,0 +1,319 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+/*
+ * Check the fields of messages sent to the journal, using a local socket in
+ * place of the journal, and measure how long it takes to send them.
+ *
+ * The first messages are logged normally and must be small enough to be
+ * sent as a datagram. The last message is sent directly from separate
+ * buffers for the fields and the text of the message (in the same way as
+ * messages that are logged) and is too large for a datagram so it must be
+ * sent as a memfd instead.
+ *
+ * The result of each check (and the time taken to send and receive a
+ * message) is printed as a JSON object on each line.
+ *
+ * Usage: journal-socket [-n <runs>]
+ */
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/uio.h>
+#include <sysexits.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../../common/log-format.h"
+#include "../../common/types.h"
+#include "../journal.h"
+#include "../logging.h"
+#include "../unique-fd.h"
+#include "results.h"
+
+using namespace hid_identify;
+
+static constexpr size_t LARGE_MESSAGE_SIZE = 1024 * 1024;
+
+using Fields = std::map<std::string, std::string>;
+
+template <class Format, class... Args>
+static void log(const LogDevice *device, Format format, const Args&... args) {
+	LogArgs values{format, args...};
+
+	vlog(LogLevel::WARNING, LogCategory::UNSUPPORTED_DEVICE, LogMessage::DEV_REPORT_COUNT_TOO_SMALL,
+		device, values.format(LogMessage::DEV_REPORT_COUNT_TOO_SMALL), values.data(), values.size());
+}
+
+/* Parse the fields of a message in the native journal protocol */
+static bool parse_fields(const std::vector<char> &data, Fields &fields) {
+	size_t pos = 0;
+
+	while (pos < data.size()) {
+		auto end = std::find(data.begin() + pos, data.end(), '\n');
+		auto equals = std::find(data.begin() + pos, end, '=');
+
+		if (end == data.end()) {
+			return false;
+		}
+
+		if (equals != end) {
+			fields[std::string(data.begin() + pos, equals)] = std::string(equals + 1, end);
+			pos = end - data.begin() + 1;
+		} else {
+			std::string name(data.begin() + pos, end);
+			uint64_t length = 0;
+
+			pos = end - data.begin() + 1;
+			if (data.size() - pos < sizeof(uint64_t)) {
+				return false;
+			}
+
+			for (size_t i = 0; i < sizeof(uint64_t); i++) {
+				length |= static_cast<uint64_t>(static_cast<uint8_t>(data[pos++])) << (i * 8);
+			}
+
+			if (data.size() - pos < length + 1 || data[pos + length] != '\n') {
+				return false;
+			}
+
+			fields[name] = std::string(data.begin() + pos, data.begin() + pos + length);
+			pos += length + 1;
+		}
+	}
+
+	return true;
+}
+
+/* Receive a message as a datagram or a memfd */
+static bool receive(int fd, std::vector<char> &data, bool &memfd) {
+	union {
+		struct cmsghdr align;
+		std::array<char, CMSG_SPACE(sizeof(int))> buf;
+	} control{};
+	struct msghdr msg{};
+	struct iovec iov;
+
+	data.resize(64 * 1024);
+	iov = {data.data(), data.size()};
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buf.data();
+	msg.msg_controllen = control.buf.size();
+
+	ssize_t len = ::recvmsg(fd, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+	if (len < 0) {
+		return false;
+	}
+
+	struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+
+	memfd = cmsg != nullptr && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS;
+	if (!memfd) {
+		data.resize(len);
+		return true;
+	}
+
+	int value;
+	struct stat st;
+
+	std::memcpy(&value, CMSG_DATA(cmsg), sizeof(value));
+	unique_fd file{value};
+
+	if (len != 0 || ::fstat(file.get(), &st)) {
+		return false;
+	}
+
+	data.resize(st.st_size);
+	return ::pread(file.get(), data.data(), data.size(), 0) == st.st_size;
+}
+
+static int check(const char *name, const Fields &fields, const char *field, const std::string &expected) {
+	auto it = fields.find(field);
+
+	if (it == fields.end()) {
+		std::cerr << name << ": " << field << " missing" << std::endl;
+		return EX_SOFTWARE;
+	} else if (it->second != expected) {
+		std::cerr << name << ": " << field << "=" << it->second << " != " << expected << std::endl;
+		return EX_SOFTWARE;
+	}
+
+	return 0;
+}
+
+int main(int argc, char *argv[]) {
+	unsigned long runs = 10000;
+	int opt;
+
+	while ((opt = ::getopt(argc, argv, "n:")) != -1) {
+		switch (opt) {
+		case 'n':
+			runs = std::strtoul(optarg, nullptr, 10);
+			break;
+
+		default:
+			return EX_USAGE;
+		}
+	}
+
+	if (optind != argc || runs < 1) {
+		return EX_USAGE;
+	}
+
+	std::array<char, 32> dir_template{"/tmp/journal-socket.XXXXXX"};
+	const char *dir = ::mkdtemp(dir_template.data());
+
+	if (dir == nullptr) {
+		std::perror("mkdtemp");
+		return EX_CANTCREAT;
+	}
+
+	std::string path = std::string{dir} + "/socket";
+	struct sockaddr_un addr{};
+	unique_fd server{::socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0)};
+
+	addr.sun_family = AF_UNIX;
+	std::snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path.c_str());
+
+	if (!server || ::bind(server.get(), reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr))) {
+		std::perror("bind");
+		::rmdir(dir);
+		return EX_CANTCREAT;
+	}
+
+	int ret = 0;
+	int status = 0;
+	std::vector<char> data;
+	bool memfd;
+	Fields fields;
+
+	/* Messages logged normally, with and without a device */
+	USBDeviceInfo info{0xfeed, 0x1307, 1};
+	LogDevice device{"/dev/hidraw3", "QMK Keyboard", &info};
+
+	set_log_journal(path.c_str());
+	log(&device, LOG_FORMAT("Report count too small (%s)"), 1U);
+	log(nullptr, LOG_FORMAT("No device"));
+	flush_log();
+
+	if (!receive(server.get(), data, memfd) || memfd || !parse_fields(data, fields)) {
+		std::cerr << "device: message not received" << std::endl;
+		status = EX_SOFTWARE;
+	} else {
+		status |= check("device", fields, "PRIORITY", std::to_string(LOG_WARNING));
+		status |= check("device", fields, "MESSAGE", "/dev/hidraw3 (QMK Keyboard): Report count too small (1)");
+		status |= check("device", fields, "MESSAGE_ID", "231bd15e1d634d4aa177399503f40120");
+		status |= check("device", fields, "QMK_CATEGORY", "UNSUPPORTED_DEVICE");
+		status |= check("device", fields, "QMK_DEVICE", "/dev/hidraw3");
+		status |= check("device", fields, "QMK_DEVICE_NAME", "QMK Keyboard");
+		status |= check("device", fields, "QMK_USB_VID", "feed");
+		status |= check("device", fields, "QMK_USB_PID", "1307");
+		status |= check("device", fields, "QMK_USB_INTERFACE", "1");
+	}
+
+	std::cout << JSONResult{}.field("benchmark", "device").field("ok", status == 0) << std::endl;
+	ret |= status;
+	status = 0;
+
+	fields.clear();
+	if (!receive(server.get(), data, memfd) || memfd || !parse_fields(data, fields)) {
+		std::cerr << "no device: message not received" << std::endl;
+		status = EX_SOFTWARE;
+	} else {
+		status |= check("no device", fields, "MESSAGE", "No device");
+		if (fields.count("QMK_DEVICE") || fields.count("QMK_USB_VID")) {
+			std::cerr << "no device: unexpected device fields" << std::endl;
+			status = EX_SOFTWARE;
+		}
+	}
+
+	std::cout << JSONResult{}.field("benchmark", "no-device").field("ok", status == 0) << std::endl;
+	ret |= status;
+	status = 0;
+
+	/* Message sent directly that is too large for a datagram, with a newline in it */
+	JournalSocket journal{path.c_str()};
+	char buf[512];
+	std::string large(LARGE_MESSAGE_SIZE, 'x');
+
+	large[LARGE_MESSAGE_SIZE / 2] = '\n';
+
+	size_t length = journal_fieldf(buf, sizeof(buf), 0, "PRIORITY", "%d", LOG_INFO);
+	size_t header_length = journal_field_name(buf, sizeof(buf), length,
+		"MESSAGE", large.data(), large.size());
+	std::array<struct iovec, 3> large_iov{{
+		{buf, header_length},
+		{large.data(), large.size()},
+		{const_cast<char*>("\n"), 1},
+	}};
+
+	fields.clear();
+	if (!journal || header_length == length || !journal.send(large_iov.data(), large_iov.size())
+			|| !receive(server.get(), data, memfd) || !memfd || !parse_fields(data, fields)) {
+		std::cerr << "large: message not received as a memfd" << std::endl;
+		status = EX_SOFTWARE;
+	} else {
+		status |= check("large", fields, "PRIORITY", std::to_string(LOG_INFO));
+		status |= check("large", fields, "MESSAGE", large);
+	}
+
+	std::cout << JSONResult{}.field("benchmark", "large").field("ok", status == 0) << std::endl;
+	ret |= status;
+	status = 0;
+
+	/* Time to send a typical message, including receiving it */
+	length = journal_fieldf(buf, sizeof(buf), 0, "PRIORITY", "%d", LOG_INFO);
+	length = journal_fieldf(buf, sizeof(buf), length, "QMK_DEVICE", "%s", "/dev/hidraw3");
+	length = journal_fieldf(buf, sizeof(buf), length, "MESSAGE", "%s", "/dev/hidraw3 (QMK Keyboard): Report sent");
+	struct iovec iov{buf, length};
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (unsigned long i = 0; i < runs; i++) {
+		if (!journal.send(&iov, 1) || !receive(server.get(), data, memfd)) {
+			std::cerr << "send failed" << std::endl;
+			status = EX_SOFTWARE;
+			break;
+		}
+	}
+
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+	std::cout << JSONResult{}
+		.field("benchmark", "send")
+		.field("runs", runs)
+		.field("ns_per_op", elapsed.count() / runs, 1)
+		.field("ok", status == 0) << std::endl;
+	ret |= status;
+
+	::unlink(path.c_str());
+	::rmdir(dir);
+	return ret;
+}
@@ -0,0 +1,220 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+/*
+ * Compare the time taken by each thread to log a message when it is written
+ * to syslog and the console immediately (as it was previously) and when it is
+ * added to the ring buffer and written in the background (current), and check
+ * that every buffered message is either written or counted as dropped.
+ * The results for each number of threads and method are printed as a JSON
+ * object on each line.
+ *
+ * Console output is redirected to /dev/null while messages are being logged.
+ *
+ * Usage: log-buffer [-n <messages>]
+ */
+#include <fcntl.h>
+#include <sysexits.h>
+#include <syslog.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../common/log-format.h"
+#include "../../common/types.h"
+#include "../logging.h"
+#include "../unique-fd.h"
+#include "results.h"
+
+using namespace hid_identify;
+
+static constexpr unsigned int ATTEMPTS = 5;
+
+static std::mutex console_mutex;
+
+/* Copy of the previous implementation of vlog() */
+static void sync_vlog(int level, const char *prefix, const char *format,
+		std::va_list args) noexcept {
+	std::array<char, 256> text;
+
+	if (std::vsnprintf(text.data(), text.size(), format, args) < 0) {
+		text[0] = '?';
+		text[1] = '\0';
+	}
+
+	auto &out = (level >= LOG_INFO) ? std::cout : std::cerr;
+
+	::syslog(LOG_USER | level, "%s: %s", prefix, text.data());
+
+	std::lock_guard<std::mutex> lock{console_mutex};
+	out << prefix << ": " << text.data() << std::endl;
+}
+
+static void sync_log(const char *format...) noexcept {
+	std::va_list args;
+
+	va_start(args, format);
+	sync_vlog(LOG_INFO, "/dev/hidraw0 (QMK Keyboard)", format, args);
+	va_end(args);
+}
+
+static void sync_report_sent() noexcept {
+	sync_log("Report sent for OS type %s", std::to_string(1U).c_str());
+}
+
+static void buffered_report_sent() noexcept {
+	LogDevice device{"/dev/hidraw0", "QMK Keyboard", nullptr};
+	LogArgs values{LOG_FORMAT("Report sent for OS type %s"), 1U};
+
+	vlog(LogLevel::INFO, LogCategory::REPORT_SENT, LogMessage::DEV_REPORT_SENT,
+		&device, values.format(LogMessage::DEV_REPORT_SENT), values.data(), values.size());
+}
+
+struct Method {
+	const char *name;
+	void (*log)() noexcept;
+};
+
+/* Time in nanoseconds per message for each thread */
+static double measure(const Method &method, unsigned int threads, unsigned long messages) {
+	std::vector<std::thread> workers;
+	std::vector<double> ns(threads);
+
+	for (unsigned int i = 0; i < threads; i++) {
+		workers.emplace_back([&method, &ns, i, messages] {
+			auto start = std::chrono::steady_clock::now();
+
+			for (unsigned long j = 0; j < messages; j++) {
+				method.log();
+			}
+
+			std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+			ns[i] = elapsed.count() / messages;
+		});
+	}
+
+	for (auto& worker : workers) {
+		worker.join();
+	}
+
+	return *std::max_element(ns.begin(), ns.end());
+}
+
+int main(int argc, char *argv[]) {
+	unsigned long messages = 1000;
+	int opt;
+
+	while ((opt = ::getopt(argc, argv, "n:")) != -1) {
+		switch (opt) {
+		case 'n':
+			messages = std::strtoul(optarg, nullptr, 10);
+			break;
+
+		default:
+			return EX_USAGE;
+		}
+	}
+
+	if (optind != argc || messages < 1) {
+		return EX_USAGE;
+	}
+
+	set_log_writer_thread(true);
+
+	static const std::array<Method, 2> methods{{
+		{"synchronous", sync_report_sent},
+		{"buffered", buffered_report_sent},
+	}};
+	static const std::array<unsigned int, 3> thread_counts{1, 4, 16};
+
+	unique_fd null{::open("/dev/null", O_WRONLY | O_CLOEXEC)};
+	unique_fd out{::dup(STDOUT_FILENO)};
+	unique_fd err{::dup(STDERR_FILENO)};
+	int ret = 0;
+
+	if (!null || !out || !err) {
+		std::perror("open");
+		return EX_OSERR;
+	}
+
+	for (unsigned int threads : thread_counts) {
+		std::vector<double> results;
+		std::vector<unsigned long> dropped;
+		LogStats before = log_stats();
+
+		for (const auto& method : methods) {
+			LogStats method_before = log_stats();
+			double best = 0;
+
+			/* Use the best of several attempts to reduce noise */
+			for (unsigned int attempt = 0; attempt < ATTEMPTS; attempt++) {
+				std::cout.flush();
+				::dup2(null.get(), STDOUT_FILENO);
+				::dup2(null.get(), STDERR_FILENO);
+
+				double ns = measure(method, threads, messages);
+
+				flush_log();
+				std::cout.flush();
+				std::cerr.flush();
+				::dup2(out.get(), STDOUT_FILENO);
+				::dup2(err.get(), STDERR_FILENO);
+
+				best = (attempt == 0) ? ns : std::min(best, ns);
+			}
+
+			results.push_back(best);
+			dropped.push_back(log_stats().dropped - method_before.dropped);
+		}
+
+		LogStats after = log_stats();
+		unsigned long expected = ATTEMPTS * threads * messages;
+		unsigned long actual = (after.written - before.written) + (after.dropped - before.dropped);
+
+		bool ok = actual == expected;
+
+		if (!ok) {
+			std::cerr << threads << " threads: " << actual
+				<< " messages written or dropped != " << expected << std::endl;
+			ret = EX_SOFTWARE;
+		}
+
+		for (size_t i = 0; i < methods.size(); i++) {
+			std::cout << JSONResult{}
+				.field("benchmark", methods[i].name)
+				.field("threads", threads)
+				.field("messages", messages)
+				.field("ns_per_op", results[i], 1)
+				.field("speedup", results.front() / results[i], 2)
+				.field("dropped", dropped[i])
+				.field("ok", ok) << std::endl;
+		}
+	}
+
+	return ret;
+}
@@ -0,0 +1,138 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+/*
+ * Compare the time taken to look up the translation of a log message format
+ * with gettext() (as it was previously, using the locale from the environment)
+ * and with the message catalog built into the program (current), checking
+ * that formats are only translated for the message they're logged with.
+ * The time taken by each method is printed as a JSON object on each line.
+ *
+ * Usage: log-catalog [-n <runs>]
+ */
+#include <libintl.h>
+#include <sysexits.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <clocale>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "../logging.h"
+#include "../../common/log-format.h"
+#include "../../common/types.h"
+#include "results.h"
+
+using namespace hid_identify;
+
+static constexpr unsigned int ATTEMPTS = 5;
+
+static const char *volatile result;
+
+template <class Function>
+static double measure(unsigned long runs, Function function) {
+	double best = 0;
+
+	/* Use the best of several attempts to reduce noise */
+	for (unsigned int attempt = 0; attempt < ATTEMPTS; attempt++) {
+		auto start = std::chrono::steady_clock::now();
+
+		for (unsigned long i = 0; i < runs; i++) {
+			function();
+		}
+
+		std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+		double ns = elapsed.count() / runs;
+
+		best = (attempt == 0) ? ns : std::min(best, ns);
+	}
+
+	return best;
+}
+
+int main(int argc, char *argv[]) {
+	unsigned long runs = 1000000;
+	int opt;
+
+	while ((opt = ::getopt(argc, argv, "n:")) != -1) {
+		switch (opt) {
+		case 'n':
+			runs = std::strtoul(optarg, nullptr, 10);
+			break;
+
+		default:
+			return EX_USAGE;
+		}
+	}
+
+	if (optind != argc || runs < 1) {
+		return EX_USAGE;
+	}
+
+	std::setlocale(LC_ALL, "");
+	select_log_language();
+
+	auto format = LOG_FORMAT("Report descriptor size too large (%s > %s)");
+	LogArgs values{format, 0, 0};
+	int ret = 0;
+
+	double previous = measure(runs, [] {
+		result = ::gettext("Report descriptor size too large (%s > %s)");
+	});
+	double current = measure(runs, [&values] {
+		result = values.format(LogMessage::DEV_REPORT_DESCRIPTOR_SIZE_TOO_LARGE);
+	});
+
+	/* Another message's translation must not be used for this format */
+	for (unsigned int message = 0; message <= static_cast<unsigned int>(LogMessage::SVC_LOG_DROPPED); message++) {
+		const char *text = values.format(static_cast<LogMessage>(message));
+
+		if (message != static_cast<unsigned int>(LogMessage::DEV_REPORT_DESCRIPTOR_SIZE_TOO_LARGE)
+				&& std::strcmp(text, format.text())) {
+			std::cerr << "Message " << message << " translated to \"" << text << "\"" << std::endl;
+			ret = EX_SOFTWARE;
+		}
+	}
+
+	if (set_log_language("C") || set_log_language("xx_XX.UTF-8")) {
+		std::cerr << "Unexpected translations for an unknown language" << std::endl;
+		ret = EX_SOFTWARE;
+	}
+
+	if (std::strcmp(values.format(LogMessage::DEV_REPORT_DESCRIPTOR_SIZE_TOO_LARGE), format.text())) {
+		std::cerr << "Translation used for an unknown language" << std::endl;
+		ret = EX_SOFTWARE;
+	}
+
+	std::cout << JSONResult{}
+		.field("benchmark", "previous")
+		.field("runs", runs)
+		.field("ns_per_op", previous, 1)
+		.field("ok", true) << std::endl;
+	std::cout << JSONResult{}
+		.field("benchmark", "current")
+		.field("runs", runs)
+		.field("ns_per_op", current, 1)
+		.field("speedup", previous / current, 1)
+		.field("ok", ret == 0) << std::endl;
+
+	return ret;
+}
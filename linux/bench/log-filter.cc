@@ -0,0 +1,164 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+/*
+ * Measure the time taken to log a message (translating and formatting it
+ * but not writing it anywhere) when it's enabled, below the log level and
+ * over the rate limit, and check the number of messages logged and counted
+ * as suppressed. The results for each filter are printed as a JSON object on
+ * each line.
+ *
+ * Usage: log-filter [-n <runs>]
+ */
+#include <sysexits.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+
+#include "../../common/log-filter.h"
+#include "../../common/log-format.h"
+#include "../../common/types.h"
+#include "results.h"
+
+using namespace hid_identify;
+
+static constexpr unsigned int ATTEMPTS = 5;
+static constexpr unsigned int RATE_LIMIT = 10;
+
+class Logger {
+public:
+	template <class Format, class... Args>
+	void log(LogLevel level, LogCategory category, LogMessage message,
+			Format format, const Args&... args) noexcept {
+		if (log_enabled(level, category)) {
+			LogArgs values{format, args...};
+			log_message(level, category, message, values.format(message), values.data(), values.size());
+		}
+	}
+
+	unsigned long count = 0;
+
+private:
+	void log_message(LogLevel level __attribute__((unused)),
+			LogCategory category __attribute__((unused)),
+			LogMessage message __attribute__((unused)),
+			const char *format, const LogArg *args, size_t size) noexcept {
+		std::array<char, 256> text;
+
+		log_format(text.data(), text.size(), format, args, size);
+		count++;
+	}
+};
+
+struct Filter {
+	const char *name;
+	LogLevel level;
+	unsigned int rate_limit;
+	/* All messages are expected to be logged */
+	bool all;
+};
+
+int main(int argc, char *argv[]) {
+	unsigned long runs = 1000000;
+	int opt;
+
+	while ((opt = ::getopt(argc, argv, "n:")) != -1) {
+		switch (opt) {
+		case 'n':
+			runs = std::strtoul(optarg, nullptr, 10);
+			break;
+
+		default:
+			return EX_USAGE;
+		}
+	}
+
+	if (optind != argc || runs < RATE_LIMIT) {
+		return EX_USAGE;
+	}
+
+	static const std::array<Filter, 3> filters{{
+		{"enabled", LogLevel::INFO, 0, true},
+		{"level", LogLevel::WARNING, 0, false},
+		{"rate limit", LogLevel::INFO, RATE_LIMIT, false},
+	}};
+	static volatile uint32_t report_count = 32;
+	int ret = 0;
+
+	for (const auto& filter : filters) {
+		double best = 0;
+		unsigned long logged = 0;
+		unsigned long suppressed = 0;
+
+		set_log_level(filter.level);
+
+		/* Use the best of several attempts to reduce noise */
+		for (unsigned int attempt = 0; attempt < ATTEMPTS; attempt++) {
+			Logger logger;
+
+			/* Start a new interval for each attempt */
+			set_log_rate_limit(filter.rate_limit, std::chrono::hours{24});
+			log_suppressed(LogCategory::UNSUPPORTED_DEVICE);
+
+			auto start = std::chrono::steady_clock::now();
+
+			for (unsigned long i = 0; i < runs; i++) {
+				logger.log(LogLevel::INFO, LogCategory::UNSUPPORTED_DEVICE, LogMessage::DEV_UNKNOWN_USAGE,
+					LOG_FORMAT("Not a QMK raw HID device interface (%s)"), report_count);
+			}
+
+			std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+			double ns = elapsed.count() / runs;
+
+			best = (attempt == 0) ? ns : std::min(best, ns);
+			logged = logger.count;
+			suppressed = log_suppressed(LogCategory::UNSUPPORTED_DEVICE);
+
+			if (filter.rate_limit) {
+				/* The interval only starts again when it has expired */
+				set_log_rate_limit(0, std::chrono::hours{0});
+				break;
+			}
+		}
+
+		unsigned long expected = filter.all ? runs : (filter.rate_limit ? filter.rate_limit : 0);
+		unsigned long expected_suppressed = filter.rate_limit ? runs - filter.rate_limit : 0;
+
+		bool ok = logged == expected && suppressed == expected_suppressed;
+
+		std::cout << JSONResult{}
+			.field("benchmark", filter.name)
+			.field("runs", runs)
+			.field("ns_per_op", best, 1)
+			.field("logged", logged)
+			.field("suppressed", suppressed)
+			.field("ok", ok) << std::endl;
+
+		if (!ok) {
+			std::cerr << filter.name << ": " << logged << " logged and " << suppressed
+				<< " suppressed, expected " << expected << " and " << expected_suppressed << std::endl;
+			ret = EX_SOFTWARE;
+		}
+	}
+
+	return ret;
+}
@@ -0,0 +1,182 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+/*
+ * Compare the time taken to format log messages with std::to_string() and
+ * vsnprintf() (as it was previously) and with LogArg and log_format()
+ * (current), checking that the text is the same. Both include the lookup of
+ * the translated format (with gettext() and the message catalog). The results
+ * for each message are printed as a JSON object on each line.
+ *
+ * Usage: log-format [-n <runs>]
+ */
+#include <libintl.h>
+#include <sysexits.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+
+#include "../../common/log-format.h"
+#include "../../common/types.h"
+#include "results.h"
+
+using namespace hid_identify;
+
+static constexpr unsigned int ATTEMPTS = 5;
+
+using Text = std::array<char, 256>;
+
+/* Previous implementation, formatting varargs that are all strings */
+static void previous_format(Text &text, const char *format...) noexcept {
+	std::va_list args;
+
+	va_start(args, format);
+	if (std::vsnprintf(text.data(), text.size(), ::gettext(format), args) < 0) {
+		text[0] = '?';
+		text[1] = '\0';
+	}
+	va_end(args);
+}
+
+template <class Format, class... Args>
+static void current_format(Text &text, LogMessage message, Format format, const Args&... args) noexcept {
+	LogArgs values{format, args...};
+
+	log_format(text.data(), text.size(), values.format(message), values.data(), values.size());
+}
+
+struct Message {
+	const char *name;
+	std::function<void(Text&)> previous;
+	std::function<void(Text&)> current;
+};
+
+int main(int argc, char *argv[]) {
+	unsigned long runs = 1000000;
+	int opt;
+
+	while ((opt = ::getopt(argc, argv, "n:")) != -1) {
+		switch (opt) {
+		case 'n':
+			runs = std::strtoul(optarg, nullptr, 10);
+			break;
+
+		default:
+			return EX_USAGE;
+		}
+	}
+
+	if (optind != argc || runs < 1) {
+		return EX_USAGE;
+	}
+
+	static volatile uint32_t report_count = 32;
+	static volatile size_t length = 64;
+	static const std::string error = "Inappropriate ioctl for device";
+
+	const std::array<Message, 4> messages{{
+		{"no arguments",
+			[] (Text &text) { previous_format(text, "Report sent"); },
+			[] (Text &text) {
+				current_format(text, LogMessage::DEV_REPORT_SENT, LOG_FORMAT("Report sent"));
+			}},
+		{"strings",
+			[] (Text &text) { previous_format(text, "%s: %s", "ioctl(HIDIOCGRAWINFO)", error.c_str()); },
+			[] (Text &text) {
+				current_format(text, LogMessage::DEV_OS_FUNC_ERROR_CODE_1,
+					LOG_FORMAT("%s: %s"), "ioctl(HIDIOCGRAWINFO)", error);
+			}},
+		{"integers",
+			[] (Text &text) {
+				previous_format(text, "Report count too small for message (%s < %s)",
+					std::to_string(report_count).c_str(), std::to_string(length - 1).c_str());
+			},
+			[] (Text &text) {
+				current_format(text, LogMessage::DEV_REPORT_COUNT_TOO_SMALL,
+					LOG_FORMAT("Report count too small for message (%s < %s)"),
+					report_count, length - 1);
+			}},
+		{"negative",
+			[] (Text &text) {
+				previous_format(text, "Report descriptor size is negative (%s)",
+					std::to_string(-static_cast<int>(length)).c_str());
+			},
+			[] (Text &text) {
+				current_format(text, LogMessage::DEV_REPORT_DESCRIPTOR_SIZE_NEGATIVE,
+					LOG_FORMAT("Report descriptor size is negative (%s)"),
+					-static_cast<int>(length));
+			}},
+	}};
+
+	int ret = 0;
+
+	for (const auto& message : messages) {
+		Text previous{};
+		Text current{};
+
+		message.previous(previous);
+		message.current(current);
+
+		bool ok = !std::strcmp(previous.data(), current.data());
+
+		if (!ok) {
+			std::cerr << message.name << ": \"" << current.data()
+				<< "\" != \"" << previous.data() << "\"" << std::endl;
+			ret = EX_SOFTWARE;
+		}
+
+		std::array<double, 2> best{};
+
+		/* Use the best of several attempts to reduce noise */
+		for (unsigned int attempt = 0; attempt < ATTEMPTS; attempt++) {
+			for (size_t method = 0; method < best.size(); method++) {
+				const auto &func = method == 0 ? message.previous : message.current;
+				Text text;
+				auto start = std::chrono::steady_clock::now();
+
+				for (unsigned long i = 0; i < runs; i++) {
+					func(text);
+				}
+
+				std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+				double ns = elapsed.count() / runs;
+
+				best[method] = (attempt == 0) ? ns : std::min(best[method], ns);
+			}
+		}
+
+		std::cout << JSONResult{}
+			.field("benchmark", message.name)
+			.field("runs", runs)
+			.field("previous_ns_per_op", best[0], 1)
+			.field("current_ns_per_op", best[1], 1)
+			.field("speedup", best[0] / best[1], 2)
+			.field("ok", ok) << std::endl;
+	}
+
+	return ret;
+}
@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+#
+#	qmk-hid-identify - Identify the current OS to QMK device
+#	Copyright 2026  Simon Arlott
+#
+#	This program is free software: you can redistribute it and/or modify
+#	it under the terms of the GNU General Public License as published by
+#	the Free Software Foundation, either version 3 of the License, or
+#	(at your option) any later version.
+#
+#	This program is distributed in the hope that it will be useful,
+#	but WITHOUT ANY WARRANTY; without even the implied warranty of
+#	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#	GNU General Public License for more details.
+#
+#	You should have received a copy of the GNU General Public License
+#	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#
+# Create a synthetic root directory containing a sysfs tree of USB hidraw
+# devices for benchmarking, for use with --sysroot.
+#
+# The devices are a mix of QMK raw HID interfaces, keyboards and mice with
+# allowed and disallowed USB VID/PIDs, some with report descriptors that are
+# composite, don't have a QMK raw HID interface or are malformed.
+#
+# Usage: make-sysfs-tree.py [-n <count>] <directory>
+
+import argparse
+import os
+
+HIDRAW_MAJOR = 240
+
+QMK_RAW = bytes.fromhex(
+	"06 60 FF 09 61 A1 01"
+	" 09 62 15 00 26 FF 00 95 20 75 08 81 02"
+	" 09 63 15 00 26 FF 00 95 20 75 08 91 02"
+	" C0")
+
+KEYBOARD = bytes.fromhex(
+	"05 01 09 06 A1 01"
+	" 05 07 19 E0 29 E7 15 00 25 01 75 01 95 08 81 02"
+	" 95 01 75 08 81 01"
+	" 05 08 19 01 29 05 95 05 75 01 91 02 95 01 75 03 91 01"
+	" 05 07 19 00 2A FF 00 15 00 26 FF 00 95 06 75 08 81 00"
+	" C0")
+
+MOUSE = bytes.fromhex(
+	"05 01 09 02 A1 01 09 01 A1 00"
+	" 05 09 19 01 29 05 15 00 25 01 95 05 75 01 81 02 95 01 75 03 81 01"
+	" 05 01 09 30 09 31 09 38 15 81 25 7F 75 08 95 03 81 06"
+	" C0 C0")
+
+# Allowed QMK keyboard, disallowed keyboard and mouse
+QMK = (0x16C0, 0x27DB)
+OTHER_KEYBOARD = (0x046D, 0xC31C)
+OTHER_MOUSE = (0x046D, 0xC077)
+
+# USB VID/PID, interface number and report descriptor of each kind of device
+DEVICES = [
+	(QMK, 0, KEYBOARD),
+	(QMK, 1, QMK_RAW),
+	(OTHER_KEYBOARD, 0, KEYBOARD),
+	(OTHER_MOUSE, 0, MOUSE),
+	(QMK, 1, KEYBOARD + MOUSE + QMK_RAW),
+	(QMK, 1, KEYBOARD),
+	(OTHER_KEYBOARD, 1, QMK_RAW),
+	(QMK, 1, QMK_RAW[:-3]),
+]
+
+
+def write(path, data):
+	with open(path, "wb" if isinstance(data, bytes) else "w") as f:
+		f.write(data)
+
+
+def symlink(target, path):
+	os.symlink(os.path.relpath(target, os.path.dirname(path)), path)
+
+
+def make_device(root, n):
+	port = n // len(DEVICES) + 1
+	(vid, pid), interface, descriptor = DEVICES[n % len(DEVICES)]
+	sysfs = os.path.join(root, "sys")
+
+	usb_dir = os.path.join(sysfs, "devices", "pci0000:00", "0000:00:14.0", "usb1", f"1-{port}")
+	intf_dir = os.path.join(usb_dir, f"1-{port}:1.{n % len(DEVICES)}")
+	hid_dir = os.path.join(intf_dir, f"0003:{vid:04X}:{pid:04X}.{n + 1:04X}")
+	hidraw_dir = os.path.join(hid_dir, "hidraw", f"hidraw{n}")
+
+	os.makedirs(hidraw_dir)
+	write(os.path.join(intf_dir, "bInterfaceNumber"), f"{interface:02x}\n")
+	write(os.path.join(hid_dir, "uevent"),
+		"DRIVER=hid-generic\n"
+		f"HID_ID=0003:{vid:08X}:{pid:08X}\n"
+		f"HID_NAME=Synthetic {vid:04X}:{pid:04X} {n}\n"
+		f"HID_PHYS=usb-0000:00:14.0-{port}/input{interface}\n"
+		"HID_UNIQ=\n"
+		f"MODALIAS=hid:b0003g0001v{vid:08X}p{pid:08X}\n")
+	write(os.path.join(hid_dir, "report_descriptor"), descriptor)
+	write(os.path.join(hidraw_dir, "dev"), f"{HIDRAW_MAJOR}:{n}\n")
+	write(os.path.join(hidraw_dir, "uevent"),
+		f"MAJOR={HIDRAW_MAJOR}\nMINOR={n}\nDEVNAME=hidraw{n}\n")
+	symlink(hid_dir, os.path.join(hidraw_dir, "device"))
+	symlink(hidraw_dir, os.path.join(sysfs, "class", "hidraw", f"hidraw{n}"))
+	symlink(hidraw_dir, os.path.join(sysfs, "dev", "char", f"{HIDRAW_MAJOR}:{n}"))
+
+
+def main():
+	parser = argparse.ArgumentParser(description="Create a synthetic root directory of hidraw devices")
+	parser.add_argument("-n", "--count", type=int, default=10000, help="number of hidraw devices")
+	parser.add_argument("directory", help="output directory (must not exist)")
+	args = parser.parse_args()
+
+	os.makedirs(args.directory)
+	os.makedirs(os.path.join(args.directory, "dev"))
+	os.makedirs(os.path.join(args.directory, "run"))
+	os.makedirs(os.path.join(args.directory, "sys", "class", "hidraw"))
+	os.makedirs(os.path.join(args.directory, "sys", "dev", "char"))
+
+	for n in range(args.count):
+		make_device(args.directory, n)
+
+
+if __name__ == "__main__":
+	main()
@@ -0,0 +1,49 @@
+#!/usr/bin/env python3
+#
+#	qmk-hid-identify - Identify the current OS to QMK device
+#	Copyright 2026  Simon Arlott
+#
+#	This program is free software: you can redistribute it and/or modify
+#	it under the terms of the GNU General Public License as published by
+#	the Free Software Foundation, either version 3 of the License, or
+#	(at your option) any later version.
+#
+#	This program is distributed in the hope that it will be useful,
+#	but WITHOUT ANY WARRANTY; without even the implied warranty of
+#	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#	GNU General Public License for more details.
+#
+#	You should have received a copy of the GNU General Public License
+#	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#
+# Create a synthetic list of allowed USB devices for benchmarking, in the
+# same format as common/usb-vid-pid.txt.
+#
+# Usage: make-usb-vid-pid.py [-n <count>] <output>
+
+import argparse
+import random
+
+PID_MASKS = [0xFFFF, 0xFFFF, 0xFFFF, 0xFFFE, 0xFFF0, 0xFF00, 0xF000]
+
+
+def main():
+	parser = argparse.ArgumentParser(description="Create a synthetic list of allowed USB devices")
+	parser.add_argument("-n", "--count", type=int, default=4096, help="number of devices")
+	parser.add_argument("output")
+	args = parser.parse_args()
+
+	rng = random.Random(0)
+	entries = set()
+
+	while len(entries) < args.count:
+		pid_mask = rng.choice(PID_MASKS)
+		entries.add((rng.randrange(1, 0x10000), rng.randrange(0x10000) & pid_mask, pid_mask))
+
+	with open(args.output, "w") as f:
+		for (vid, pid, pid_mask) in sorted(entries):
+			f.write(f"{vid:04X} {pid:04X} {pid_mask:04X}\n")
+
+
+if __name__ == "__main__":
+	main()
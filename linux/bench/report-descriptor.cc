@@ -0,0 +1,248 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+/*
+ * Compare the time taken to read and parse the report descriptors of every
+ * hidraw device in a root directory, using sysfs or the hidraw ioctls.
+ *
+ * The ioctl method needs the device nodes (<root>/dev/<name>) to be readable.
+ * When they're not (e.g. a synthetic root directory created by
+ * make-sysfs-tree.py) it is emulated by reading the size and then the
+ * contents of the descriptor with separate system calls into an intermediate
+ * buffer that is then copied.
+ *
+ * The results for each method are printed as a JSON object on each line. It
+ * is skipped if there are no devices and a root directory isn't specified.
+ *
+ * Usage: report-descriptor [-n <runs>] [<root directory>]
+ */
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sysexits.h>
+#include <unistd.h>
+
+#include <linux/hidraw.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../../common/types.h"
+#include "../hid-report-desc.h"
+#include "../sysfs.h"
+#include "../sysroot.h"
+#include "../unique-fd.h"
+#include "results.h"
+
+using namespace hid_identify;
+
+struct Device {
+	std::string name;
+	unique_fd sysfs_fd;
+	unique_fd dev_fd;
+};
+
+static size_t parse(const uint8_t *value, size_t size) {
+	HIDReportParser parser{value, size};
+	HIDReports reports;
+	size_t count = 0;
+	int ret;
+
+	do {
+		ret = parser.next(reports);
+		if (ret == 0) {
+			reports.pop_back();
+			count++;
+		}
+	} while (ret == 0);
+
+	return count;
+}
+
+static size_t read_sysfs(const Device &device) {
+	thread_local struct hidraw_report_descriptor rpt_desc;
+
+	ssize_t len = HIDRawSysfs::report_descriptor(device.sysfs_fd.get(),
+		rpt_desc.value, sizeof(rpt_desc.value));
+	if (len <= 0) {
+		std::cerr << device.name << ": unable to read report descriptor" << std::endl;
+		std::exit(EX_IOERR);
+	}
+
+	return parse(rpt_desc.value, len);
+}
+
+static size_t read_ioctl(const Device &device) {
+	struct hidraw_report_descriptor rpt_desc{};
+	int desc_size = 0;
+
+	if (::ioctl(device.dev_fd.get(), HIDIOCGRDESCSIZE, &desc_size) < 0
+			|| desc_size < 0 || (unsigned int)desc_size > sizeof(rpt_desc.value)) {
+		std::cerr << device.name << ": ioctl(HIDIOCGRDESCSIZE) failed" << std::endl;
+		std::exit(EX_IOERR);
+	}
+
+	rpt_desc.size = desc_size;
+	if (::ioctl(device.dev_fd.get(), HIDIOCGRDESC, &rpt_desc) < 0) {
+		std::cerr << device.name << ": ioctl(HIDIOCGRDESC) failed" << std::endl;
+		std::exit(EX_IOERR);
+	}
+
+	return parse(rpt_desc.value, rpt_desc.size);
+}
+
+static size_t read_ioctl_emulated(const Device &device) {
+	struct hidraw_report_descriptor rpt_desc{};
+	uint8_t kernel_buf[HID_MAX_DESCRIPTOR_SIZE];
+	unique_fd fd{::openat(device.sysfs_fd.get(), "report_descriptor", O_RDONLY | O_CLOEXEC)};
+	struct stat st;
+
+	/* sysfs always reports a size of 4096 so this is only the cost of the call */
+	if (!fd || ::fstat(fd.get(), &st) < 0) {
+		std::cerr << device.name << ": unable to open report descriptor" << std::endl;
+		std::exit(EX_IOERR);
+	}
+
+	ssize_t len = ::pread(fd.get(), kernel_buf, sizeof(kernel_buf), 0);
+	if (len <= 0) {
+		std::cerr << device.name << ": unable to read report descriptor" << std::endl;
+		std::exit(EX_IOERR);
+	}
+
+	rpt_desc.size = len;
+	std::memcpy(rpt_desc.value, kernel_buf, len);
+	return parse(rpt_desc.value, rpt_desc.size);
+}
+
+int main(int argc, char *argv[]) {
+	unsigned long runs = 1000;
+	int opt;
+
+	while ((opt = ::getopt(argc, argv, "n:")) != -1) {
+		switch (opt) {
+		case 'n':
+			runs = std::strtoul(optarg, nullptr, 10);
+			break;
+
+		default:
+			std::cerr << "Usage: " << argv[0] << " [-n <runs>] [<root directory>]" << std::endl;
+			return EX_USAGE;
+		}
+	}
+
+	if (optind < argc) {
+		set_sysroot(argv[optind++]);
+	}
+
+	if (optind != argc || runs == 0) {
+		std::cerr << "Usage: " << argv[0] << " [-n <runs>] [<root directory>]" << std::endl;
+		return EX_USAGE;
+	}
+
+	std::string class_dir = sysroot_path("/sys/class/hidraw");
+	DIR *dir = ::opendir(class_dir.c_str());
+	if (dir == nullptr) {
+		std::cerr << class_dir << ": " << std::strerror(errno) << std::endl;
+		return sysroot().empty() ? SKIPPED : EX_NOINPUT;
+	}
+
+	std::vector<Device> devices;
+	bool have_dev = true;
+
+	while (struct dirent *entry = ::readdir(dir)) {
+		if (entry->d_name[0] == '.') {
+			continue;
+		}
+
+		Device device{entry->d_name, {}, {}};
+		std::string pathname = class_dir + "/" + entry->d_name + "/device";
+
+		device.sysfs_fd = unique_fd{::open(pathname.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC)};
+		if (!device.sysfs_fd) {
+			std::cerr << pathname << ": " << std::strerror(errno) << std::endl;
+			continue;
+		}
+
+		pathname = sysroot_path("/dev/" + device.name);
+		device.dev_fd = unique_fd{::open(pathname.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC)};
+		if (!device.dev_fd) {
+			have_dev = false;
+		}
+
+		devices.push_back(std::move(device));
+	}
+	::closedir(dir);
+
+	if (devices.empty()) {
+		std::cerr << class_dir << ": no devices" << std::endl;
+		return sysroot().empty() ? SKIPPED : EX_NOINPUT;
+	}
+
+	struct Method {
+		const char *name;
+		size_t (*read)(const Device &device);
+	};
+	std::vector<Method> methods{
+		{"sysfs", read_sysfs},
+		have_dev ? Method{"ioctl", read_ioctl} : Method{"ioctl-emulated", read_ioctl_emulated},
+	};
+	size_t expected = 0;
+	int ret = 0;
+
+	for (const auto& method : methods) {
+		size_t usages = 0;
+		auto start = std::chrono::steady_clock::now();
+
+		for (unsigned long i = 0; i < runs; i++) {
+			usages = 0;
+
+			for (const auto& device : devices) {
+				usages += method.read(device);
+			}
+		}
+
+		std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+
+		/* Every method must find the same usages */
+		if (&method == &methods.front()) {
+			expected = usages;
+		}
+
+		bool ok = usages == expected;
+
+		std::cout << JSONResult{}
+			.field("benchmark", method.name)
+			.field("devices", devices.size())
+			.field("usages", usages)
+			.field("us_per_device", elapsed.count() / runs / devices.size())
+			.field("ok", ok) << std::endl;
+
+		if (!ok) {
+			ret = EX_SOFTWARE;
+		}
+	}
+
+	return ret;
+}
@@ -0,0 +1,87 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+/*
+ * Benchmark results are printed as one JSON object per line so that they can
+ * be tracked over time:
+ *
+ *   std::cout << JSONResult{}.field("benchmark", name).field("ok", ok) << std::endl;
+ *
+ * Benchmarks exit with a non-zero status if any result is not ok.
+ */
+#pragma once
+
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+
+/* Exit status for a benchmark that can't be run here, which meson reports as skipped */
+static constexpr int SKIPPED = 77;
+
+class JSONResult {
+public:
+	JSONResult& field(const char *name, const char *value) {
+		key(name);
+		text_ << '"';
+		for (const char *c = value; *c; c++) {
+			if (*c == '"' || *c == '\\') {
+				text_ << '\\';
+			}
+			text_ << *c;
+		}
+		text_ << '"';
+		return *this;
+	}
+
+	JSONResult& field(const char *name, const std::string &value) {
+		return field(name, value.c_str());
+	}
+
+	JSONResult& field(const char *name, bool value) {
+		key(name);
+		text_ << (value ? "true" : "false");
+		return *this;
+	}
+
+	template <class T, std::enable_if_t<std::is_integral_v<T>, bool> = true>
+	JSONResult& field(const char *name, T value) {
+		key(name);
+		text_ << value;
+		return *this;
+	}
+
+	JSONResult& field(const char *name, double value, int precision = 3) {
+		key(name);
+		text_ << std::fixed << std::setprecision(precision) << value;
+		return *this;
+	}
+
+	std::string str() const { return text_.str() + "}"; }
+
+private:
+	void key(const char *name) {
+		text_ << (text_.tellp() > 0 ? "," : "{") << '"' << name << "\":";
+	}
+
+	std::ostringstream text_;
+};
+
+inline std::ostream& operator<<(std::ostream &out, const JSONResult &result) {
+	return out << result.str();
+}
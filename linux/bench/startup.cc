@@ -0,0 +1,201 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+/*
+ * Measure the time from starting qmk-hid-identify until it exits, running it
+ * <runs> times one after another and then <runs> times at the same time, for
+ * each build of the program (e.g. the default build and one built with
+ * -Dfast_start=true). This is how udev runs it, once for every device.
+ *
+ * The program is run with <device> (/dev/null by default, which it rejects
+ * after opening it) and its output is discarded. Every build must exit with
+ * the same status. The results for each build are printed as a JSON object
+ * on each line.
+ *
+ * Usage: startup [-n <runs>] [-d <device>] <qmk-hid-identify>...
+ */
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <sysexits.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "results.h"
+
+using Clock = std::chrono::steady_clock;
+
+static constexpr unsigned int ATTEMPTS = 5;
+
+struct Program {
+	explicit Program(const char *path_) : path(path_) {}
+
+	std::string path;
+	/* Exit status of the first run, or -1 if it didn't exit normally */
+	int status = -1;
+	bool consistent = true;
+
+	/* Best time per run */
+	double sequential_us = 0;
+	double concurrent_us = 0;
+};
+
+static pid_t start(const Program &program, const char *device) {
+	pid_t pid = ::fork();
+
+	if (pid == 0) {
+		int fd = ::open("/dev/null", O_RDWR | O_CLOEXEC);
+
+		if (fd >= 0) {
+			::dup2(fd, STDOUT_FILENO);
+			::dup2(fd, STDERR_FILENO);
+		}
+
+		::execl(program.path.c_str(), program.path.c_str(), device, nullptr);
+		::_exit(EX_UNAVAILABLE);
+	} else if (pid < 0) {
+		std::perror("fork");
+	}
+
+	return pid;
+}
+
+static void finish(Program &program, pid_t pid) {
+	int wstatus = 0;
+	int status = -1;
+
+	if (pid > 0 && ::waitpid(pid, &wstatus, 0) == pid && WIFEXITED(wstatus)) {
+		status = WEXITSTATUS(wstatus);
+	}
+
+	if (program.status == -1 && program.consistent) {
+		program.status = status;
+	}
+
+	if (status == -1 || status == EX_UNAVAILABLE || status != program.status) {
+		program.consistent = false;
+	}
+}
+
+static double run_sequential(Program &program, const char *device, unsigned long runs) {
+	auto begin = Clock::now();
+
+	for (unsigned long i = 0; i < runs; i++) {
+		finish(program, start(program, device));
+	}
+
+	std::chrono::duration<double, std::micro> elapsed = Clock::now() - begin;
+	return elapsed.count() / runs;
+}
+
+static double run_concurrent(Program &program, const char *device, unsigned long runs) {
+	std::vector<pid_t> pids;
+	auto begin = Clock::now();
+
+	pids.reserve(runs);
+	for (unsigned long i = 0; i < runs; i++) {
+		pids.push_back(start(program, device));
+	}
+
+	for (pid_t pid : pids) {
+		finish(program, pid);
+	}
+
+	std::chrono::duration<double, std::micro> elapsed = Clock::now() - begin;
+	return elapsed.count() / runs;
+}
+
+int main(int argc, char *argv[]) {
+	unsigned long runs = 100;
+	const char *device = "/dev/null";
+	int opt;
+
+	while ((opt = ::getopt(argc, argv, "n:d:")) != -1) {
+		switch (opt) {
+		case 'n':
+			runs = std::strtoul(optarg, nullptr, 10);
+			break;
+
+		case 'd':
+			device = optarg;
+			break;
+
+		default:
+			return EX_USAGE;
+		}
+	}
+
+	if (optind == argc || runs < 1) {
+		std::cerr << "Usage: " << argv[0] << " [-n <runs>] [-d <device>] <qmk-hid-identify>..." << std::endl;
+		return EX_USAGE;
+	}
+
+	std::vector<Program> programs;
+
+	for (int i = optind; i < argc; i++) {
+		programs.emplace_back(argv[i]);
+	}
+
+	/*
+	 * Use the best of several attempts to reduce noise, alternating between
+	 * programs so that they're all affected by the same background load.
+	 */
+	for (unsigned int attempt = 0; attempt < ATTEMPTS; attempt++) {
+		for (auto& program : programs) {
+			double sequential_us = run_sequential(program, device, runs);
+			double concurrent_us = run_concurrent(program, device, runs);
+
+			if (attempt == 0) {
+				program.sequential_us = sequential_us;
+				program.concurrent_us = concurrent_us;
+			} else {
+				program.sequential_us = std::min(program.sequential_us, sequential_us);
+				program.concurrent_us = std::min(program.concurrent_us, concurrent_us);
+			}
+		}
+	}
+
+	int ret = 0;
+
+	for (const auto& program : programs) {
+		const auto &first = programs.front();
+		bool ok = program.consistent && program.status == first.status;
+
+		std::cout << JSONResult{}
+			.field("benchmark", program.path)
+			.field("sequential_us", program.sequential_us, 1)
+			.field("sequential_speedup", first.sequential_us / program.sequential_us, 2)
+			.field("concurrent_us", program.concurrent_us, 1)
+			.field("concurrent_speedup", first.concurrent_us / program.concurrent_us, 2)
+			.field("status", program.status)
+			.field("ok", ok) << std::endl;
+
+		if (!ok) {
+			std::cerr << program.path << ": exit status differs or is inconsistent" << std::endl;
+			ret = EX_SOFTWARE;
+		}
+	}
+
+	return ret;
+}
@@ -0,0 +1,260 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+/*
+ * Measure how the time taken to scan sysfs for hidraw devices, filter them
+ * by USB device and parse their report descriptors scales with the number of
+ * devices, using synthetic root directories of different sizes created by
+ * make-sysfs-tree.py (e.g. with 1000, 2500, 5000 and 10000 devices).
+ *
+ * The time per device must not increase by more than a factor of 2 between
+ * the smallest and largest root directory. The results for each root
+ * directory are printed as a JSON object on each line.
+ *
+ * Usage: sysfs-scaling [-n <runs>] <root directory>...
+ */
+#include <dirent.h>
+#include <sysexits.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../../common/hid-device.h"
+#include "../../common/types.h"
+#include "../hid-report-desc.h"
+#include "../report-desc-scan.h"
+#include "../sysfs.h"
+#include "results.h"
+
+using namespace hid_identify;
+
+static constexpr unsigned int ATTEMPTS = 10;
+static constexpr double MAX_RATIO = 2.0;
+
+static const std::array<const char*, 3> STAGES{"scan", "filter", "parse"};
+
+struct Root {
+	explicit Root(const std::string &path_) : path(path_), sysfs(path_) {}
+
+	std::string path;
+	HIDRawSysfs sysfs;
+	size_t devices = 0;
+	std::vector<USBDeviceInfo> infos;
+	std::vector<HIDRawSysfsDevice> allowed;
+	size_t raw = 0;
+
+	/* Best time per device of each stage */
+	std::array<double, STAGES.size()> ns_per_device{};
+};
+
+static std::vector<std::string> list_devices(const std::string &root) {
+	std::vector<std::string> names;
+	DIR *dir = ::opendir((root + "/sys/class/hidraw").c_str());
+
+	if (dir == nullptr) {
+		return names;
+	}
+
+	while (struct dirent *entry = ::readdir(dir)) {
+		if (entry->d_name[0] != '.') {
+			names.push_back(entry->d_name);
+		}
+	}
+
+	::closedir(dir);
+	return names;
+}
+
+static bool has_raw_interface(const uint8_t *value, size_t size) {
+	if (!find_raw_usage_page(value, size)) {
+		return false;
+	}
+
+	HIDReportParser parser{value, size};
+	HIDReports reports;
+
+	while (parser.find_next(HIDDevice::RAW_USAGE_PAGE, reports) == 0) {
+		if (HIDDevice::raw_report_count(reports, reports.size() - 1) > 0) {
+			return true;
+		}
+		reports.pop_back();
+	}
+
+	return false;
+}
+
+static size_t parse_all(const std::vector<HIDRawSysfsDevice> &devices) {
+	std::array<uint8_t, 4096> descriptor;
+	size_t raw = 0;
+
+	for (const auto& device : devices) {
+		ssize_t len = HIDRawSysfs::report_descriptor(device.fd.get(), descriptor.data(), descriptor.size());
+
+		raw += len > 0 && has_raw_interface(descriptor.data(), len);
+	}
+
+	return raw;
+}
+
+static bool init(Root &root) {
+	auto names = list_devices(root.path);
+
+	for (const auto& name : names) {
+		std::array<char, HID_PHYS_SIZE> phys;
+		USBDeviceInfo info{};
+		unique_fd fd = root.sysfs.open_device(name.c_str());
+
+		if (fd && HIDRawSysfs::device_info(fd.get(), info, phys)) {
+			root.infos.push_back(info);
+		}
+	}
+
+	root.devices = names.size();
+	root.allowed = root.sysfs.allowed_devices();
+	root.raw = parse_all(root.allowed);
+
+	return !root.infos.empty() && !root.allowed.empty();
+}
+
+/* Time in nanoseconds per device of each stage */
+static std::array<double, STAGES.size()> measure(const Root &root, unsigned long runs) {
+	std::array<double, STAGES.size()> ns;
+	volatile size_t count = 0;
+
+	auto time = [runs] (const std::function<void()> &func) {
+		auto start = std::chrono::steady_clock::now();
+
+		for (unsigned long i = 0; i < runs; i++) {
+			func();
+		}
+
+		std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+		return elapsed.count() / runs;
+	};
+
+	ns[0] = time([&] {
+		count = count + root.sysfs.allowed_devices().size();
+	}) / root.devices;
+
+	ns[1] = time([&] {
+		size_t allowed = 0;
+
+		for (const auto& info : root.infos) {
+			allowed += HIDDevice::device_allowed(info);
+		}
+
+		count = count + allowed;
+	}) / root.infos.size();
+
+	ns[2] = time([&] {
+		count = count + parse_all(root.allowed);
+	}) / root.allowed.size();
+
+	return ns;
+}
+
+int main(int argc, char *argv[]) {
+	unsigned long runs = 3;
+	int opt;
+
+	while ((opt = ::getopt(argc, argv, "n:")) != -1) {
+		switch (opt) {
+		case 'n':
+			runs = std::strtoul(optarg, nullptr, 10);
+			break;
+
+		default:
+			std::cerr << "Usage: " << argv[0] << " [-n <runs>] <root directory>..." << std::endl;
+			return EX_USAGE;
+		}
+	}
+
+	if (optind == argc || runs == 0) {
+		std::cerr << "Usage: " << argv[0] << " [-n <runs>] <root directory>..." << std::endl;
+		return EX_USAGE;
+	}
+
+	std::vector<Root> roots;
+
+	roots.reserve(argc - optind);
+	for (int i = optind; i < argc; i++) {
+		roots.emplace_back(argv[i]);
+
+		if (!init(roots.back())) {
+			std::cerr << argv[i] << ": no devices" << std::endl;
+			return EX_NOINPUT;
+		}
+	}
+
+	std::sort(roots.begin(), roots.end(),
+		[] (const Root &a, const Root &b) { return a.devices < b.devices; });
+
+	/*
+	 * Use the best of several attempts to reduce noise, alternating between
+	 * the root directories so that they're all affected by it equally.
+	 */
+	for (unsigned int attempt = 0; attempt < ATTEMPTS; attempt++) {
+		for (auto& root : roots) {
+			auto ns = measure(root, runs);
+
+			for (size_t stage = 0; stage < STAGES.size(); stage++) {
+				if (attempt == 0 || ns[stage] < root.ns_per_device[stage]) {
+					root.ns_per_device[stage] = ns[stage];
+				}
+			}
+		}
+	}
+
+	int ret = 0;
+
+	for (const auto& root : roots) {
+		JSONResult result;
+
+		result.field("benchmark", std::to_string(root.devices) + "-devices")
+			.field("devices", root.devices)
+			.field("allowed", root.allowed.size())
+			.field("qmk", root.raw);
+		for (size_t stage = 0; stage < STAGES.size(); stage++) {
+			result.field((std::string{STAGES[stage]} + "_ns_per_device").c_str(), root.ns_per_device[stage], 1);
+		}
+
+		/* Compare the time per device with the smallest root directory */
+		bool ok = true;
+
+		for (size_t stage = 0; stage < STAGES.size(); stage++) {
+			double ratio = root.ns_per_device[stage] / roots.front().ns_per_device[stage];
+
+			result.field((std::string{STAGES[stage]} + "_ratio").c_str(), ratio, 2);
+			if (ratio > MAX_RATIO) {
+				ok = false;
+				ret = EX_SOFTWARE;
+			}
+		}
+
+		std::cout << result.field("ok", ok) << std::endl;
+	}
+
+	return ret;
+}
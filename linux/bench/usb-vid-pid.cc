@@ -0,0 +1,146 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+/*
+ * Compare the time taken to check if a USB device is allowed using the
+ * generated perfect hash table and a linear search, with a synthetic list of
+ * thousands of devices. The results for each method are printed as a JSON
+ * object on each line.
+ *
+ * Usage: usb-vid-pid [-n <lookups>]
+ */
+#include <sysexits.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "../../common/usb-vid-pid.h"
+#include "bench-usb-vid-pid-table.h"
+#include "results.h"
+
+using namespace hid_identify;
+
+static_assert(usb_device_table_valid<BenchUSBDevices>(), "Benchmark USB device table is invalid");
+
+static bool linear_search(uint16_t vid, uint16_t pid) {
+	for (auto& device : BenchUSBDevices::DEVICES) {
+		if (vid == device.vid && (pid & device.pid_mask) == device.pid) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool hash_lookup(uint16_t vid, uint16_t pid) {
+	return usb_device_in_table<BenchUSBDevices>(vid, pid);
+}
+
+int main(int argc, char *argv[]) {
+	unsigned long lookups = 1000000;
+	int opt;
+
+	while ((opt = ::getopt(argc, argv, "n:")) != -1) {
+		switch (opt) {
+		case 'n':
+			lookups = std::strtoul(optarg, nullptr, 10);
+			break;
+
+		default:
+			std::cerr << "Usage: " << argv[0] << " [-n <lookups>]" << std::endl;
+			return EX_USAGE;
+		}
+	}
+
+	if (optind != argc || lookups == 0) {
+		std::cerr << "Usage: " << argv[0] << " [-n <lookups>]" << std::endl;
+		return EX_USAGE;
+	}
+
+	/* Half of the lookups are for devices in the list */
+	std::mt19937 rng{0};
+	std::vector<std::pair<uint16_t, uint16_t>> queries;
+
+	queries.reserve(lookups);
+	for (unsigned long i = 0; i < lookups; i++) {
+		if (i % 2) {
+			auto &device = BenchUSBDevices::DEVICES[rng() % BenchUSBDevices::DEVICES.size()];
+
+			queries.emplace_back(device.vid, device.pid | (rng() & ~device.pid_mask));
+		} else {
+			queries.emplace_back(rng(), rng());
+		}
+	}
+
+	for (auto& query : queries) {
+		if (linear_search(query.first, query.second) != hash_lookup(query.first, query.second)) {
+			std::cerr << std::hex << query.first << ":" << query.second
+				<< ": lookup results differ" << std::endl;
+			return EX_SOFTWARE;
+		}
+	}
+
+	struct Method {
+		const char *name;
+		bool (*lookup)(uint16_t vid, uint16_t pid);
+	};
+	const std::vector<Method> methods{
+		{"hash", hash_lookup},
+		{"linear", linear_search},
+	};
+
+	unsigned long expected = 0;
+	int ret = 0;
+
+	for (const auto& method : methods) {
+		unsigned long allowed = 0;
+		auto start = std::chrono::steady_clock::now();
+
+		for (auto& query : queries) {
+			allowed += method.lookup(query.first, query.second);
+		}
+
+		std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+		/* Every method must allow the same devices */
+		if (&method == &methods.front()) {
+			expected = allowed;
+		}
+
+		bool ok = allowed == expected;
+
+		std::cout << JSONResult{}
+			.field("benchmark", method.name)
+			.field("devices", BenchUSBDevices::DEVICES.size())
+			.field("lookups", queries.size())
+			.field("allowed", allowed)
+			.field("ns_per_op", elapsed.count() / queries.size())
+			.field("ok", ok) << std::endl;
+
+		if (!ok) {
+			ret = EX_SOFTWARE;
+		}
+	}
+
+	return ret;
+}
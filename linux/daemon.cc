@@ -0,0 +1,359 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "daemon.h"
+
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <linux/netlink.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../common/types.h"
+#include "hid-identify.h"
+#include "logging.h"
+#include "sysfs.h"
+#include "sysroot.h"
+#include "unique-fd.h"
+
+namespace hid_identify {
+
+/* Messages from the kernel are limited to UEVENT_BUFFER_SIZE (2048) */
+static constexpr size_t UEVENT_BUFFER_SIZE = 8192;
+static constexpr int UEVENT_RECEIVE_BUFFER_SIZE = 1024 * 1024;
+static constexpr unsigned int UEVENT_GROUP_KERNEL = 1;
+
+LinuxHIDDaemon::LinuxHIDDaemon(unsigned int jobs) : jobs_(std::max(jobs, 1U)) {
+}
+
+LinuxHIDDaemon::~LinuxHIDDaemon() {
+	stop_workers();
+}
+
+int LinuxHIDDaemon::run() {
+	log(LogLevel::INFO, LogCategory::SERVICE, LogMessage::SVC_STARTING,
+		LOG_FORMAT("Service starting"));
+
+	startup();
+	start_workers();
+
+	log(LogLevel::INFO, LogCategory::SERVICE, LogMessage::SVC_STARTED,
+		LOG_FORMAT("Service started"));
+
+	coldplug();
+
+	std::array<struct pollfd, 2> fds{};
+
+	fds[0].fd = signal_fd_.get();
+	fds[0].events = POLLIN;
+	fds[1].fd = uevent_fd_.get();
+	fds[1].events = POLLIN;
+
+	while (1) {
+		if (::poll(fds.data(), fds.size(), -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			log(LogLevel::ERROR, LogCategory::OS_ERROR, LogMessage::SVC_OS_FUNC_ERROR_CODE_1,
+				LOG_FORMAT("%s: %s"), "poll", get_strerror().c_str());
+			log(LogLevel::ERROR, LogCategory::SERVICE, LogMessage::SVC_FAILED,
+				LOG_FORMAT("Service failed"));
+			throw_error(OSError{});
+		}
+
+		if (fds[0].revents) {
+			if (process_signal()) {
+				break;
+			}
+		}
+
+		if (fds[1].revents) {
+			process_uevent();
+		}
+	}
+
+	log(LogLevel::INFO, LogCategory::SERVICE, LogMessage::SVC_STOPPING,
+		LOG_FORMAT("Service stopping"));
+
+	stop_workers();
+	uevent_fd_.clear();
+	signal_fd_.clear();
+
+	log(LogLevel::INFO, LogCategory::SERVICE, LogMessage::SVC_STOPPED,
+		LOG_FORMAT("Service stopped"));
+	return 0;
+}
+
+void LinuxHIDDaemon::startup() {
+	sigset_t mask;
+
+	::sigemptyset(&mask);
+	::sigaddset(&mask, SIGINT);
+	::sigaddset(&mask, SIGTERM);
+
+	if (::sigprocmask(SIG_BLOCK, &mask, nullptr) < 0) {
+		log(LogLevel::ERROR, LogCategory::OS_ERROR, LogMessage::SVC_OS_FUNC_ERROR_CODE_1,
+			LOG_FORMAT("%s: %s"), "sigprocmask", get_strerror().c_str());
+		throw_error(OSError{});
+	}
+
+	signal_fd_ = unique_fd(::signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC));
+	if (!signal_fd_) {
+		log(LogLevel::ERROR, LogCategory::OS_ERROR, LogMessage::SVC_OS_FUNC_ERROR_CODE_1,
+			LOG_FORMAT("%s: %s"), "signalfd", get_strerror().c_str());
+		throw_error(OSError{});
+	}
+
+	uevent_fd_ = unique_fd(::socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+		NETLINK_KOBJECT_UEVENT));
+	if (!uevent_fd_) {
+		log(LogLevel::ERROR, LogCategory::OS_ERROR, LogMessage::SVC_OS_FUNC_ERROR_CODE_1,
+			LOG_FORMAT("%s: %s"), "socket(NETLINK_KOBJECT_UEVENT)", get_strerror().c_str());
+		throw_error(OSError{});
+	}
+
+	/*
+	 * Events are lost if the socket buffer overflows, so try to make it large
+	 * enough to cope with lots of devices being connected at the same time.
+	 */
+	int size = UEVENT_RECEIVE_BUFFER_SIZE;
+	if (::setsockopt(uevent_fd_.get(), SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof(size)) < 0) {
+		::setsockopt(uevent_fd_.get(), SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+	}
+
+	/* Used to measure the time between the event and the report being sent */
+	int on = 1;
+	if (::setsockopt(uevent_fd_.get(), SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) < 0) {
+		log(LogLevel::ERROR, LogCategory::OS_ERROR, LogMessage::SVC_OS_FUNC_ERROR_CODE_1,
+			LOG_FORMAT("%s: %s"), "setsockopt(SO_TIMESTAMPNS)", get_strerror().c_str());
+		throw_error(OSError{});
+	}
+
+	struct sockaddr_nl addr{};
+	addr.nl_family = AF_NETLINK;
+	addr.nl_groups = UEVENT_GROUP_KERNEL;
+
+	if (::bind(uevent_fd_.get(), reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+		log(LogLevel::ERROR, LogCategory::OS_ERROR, LogMessage::SVC_OS_FUNC_ERROR_CODE_1,
+			LOG_FORMAT("%s: %s"), "bind(NETLINK_KOBJECT_UEVENT)", get_strerror().c_str());
+		throw_error(OSError{});
+	}
+}
+
+void LinuxHIDDaemon::start_workers() {
+	workers_.reserve(jobs_);
+	for (unsigned int i = 0; i < jobs_; i++) {
+		workers_.emplace_back(&LinuxHIDDaemon::worker, this);
+	}
+}
+
+/* Wait for devices that are being identified, discarding the rest */
+void LinuxHIDDaemon::stop_workers() noexcept {
+	{
+		std::lock_guard<std::mutex> lock{queue_mutex_};
+
+		stopping_ = true;
+		queue_.clear();
+	}
+
+	queue_cv_.notify_all();
+
+	for (auto& worker : workers_) {
+		worker.join();
+	}
+
+	workers_.clear();
+}
+
+void LinuxHIDDaemon::worker() noexcept {
+	while (1) {
+		std::unique_ptr<LinuxHIDDevice> device;
+
+		{
+			std::unique_lock<std::mutex> lock{queue_mutex_};
+
+			queue_cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+			if (stopping_) {
+				return;
+			}
+
+			device = std::move(queue_.front());
+			queue_.pop_front();
+		}
+
+		HID_TRY {
+			(void)device->identify();
+		} HID_CATCH(const Exception&) {
+			// ignored
+		}
+	}
+}
+
+void LinuxHIDDaemon::identify(std::unique_ptr<LinuxHIDDevice> device) {
+	{
+		std::lock_guard<std::mutex> lock{queue_mutex_};
+
+		queue_.push_back(std::move(device));
+	}
+
+	queue_cv_.notify_one();
+}
+
+/*
+ * Identify the devices that are already present. This happens after the
+ * uevent socket has been created so that no devices can be missed, but any
+ * that are added in the meantime will be identified twice.
+ */
+void LinuxHIDDaemon::coldplug() {
+	for (auto& device : HIDRawSysfs::instance().allowed_devices()) {
+		identify(std::make_unique<LinuxHIDDevice>(std::move(device)));
+	}
+}
+
+bool LinuxHIDDaemon::process_signal() {
+	struct signalfd_siginfo info{};
+
+	ssize_t ret = ::read(signal_fd_.get(), &info, sizeof(info));
+	if (ret < 0) {
+		if (errno == EAGAIN || errno == EINTR) {
+			return false;
+		}
+
+		log(LogLevel::ERROR, LogCategory::OS_ERROR, LogMessage::SVC_OS_FUNC_ERROR_CODE_1,
+			LOG_FORMAT("%s: %s"), "read(signalfd)", get_strerror().c_str());
+		throw_error(OSError{});
+	}
+
+	return ret == sizeof(info);
+}
+
+void LinuxHIDDaemon::process_uevent() {
+	std::vector<char> buf(UEVENT_BUFFER_SIZE);
+	std::array<char, CMSG_SPACE(sizeof(struct timespec))> control{};
+	bool overflow = false;
+
+	while (1) {
+		struct sockaddr_nl addr{};
+		struct iovec iov{};
+		struct msghdr msg{};
+
+		iov.iov_base = buf.data();
+		iov.iov_len = buf.size() - 1;
+		msg.msg_name = &addr;
+		msg.msg_namelen = sizeof(addr);
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = control.data();
+		msg.msg_controllen = control.size();
+
+		ssize_t len = ::recvmsg(uevent_fd_.get(), &msg, 0);
+		if (len < 0) {
+			if (errno == EAGAIN || errno == EINTR) {
+				/* Find any devices that were added by events that were lost */
+				if (overflow) {
+					coldplug();
+				}
+				return;
+			} else if (errno == ENOBUFS) {
+				log(LogLevel::WARNING, LogCategory::SERVICE, LogMessage::SVC_UEVENT_OVERFLOW,
+					LOG_FORMAT("Kernel uevent buffer overflow, events have been lost"));
+				overflow = true;
+				continue;
+			}
+
+			log(LogLevel::ERROR, LogCategory::OS_ERROR, LogMessage::SVC_OS_FUNC_ERROR_CODE_1,
+				LOG_FORMAT("%s: %s"), "recvmsg(NETLINK_KOBJECT_UEVENT)", get_strerror().c_str());
+			throw_error(OSError{});
+		}
+
+		/* Only accept messages from the kernel */
+		if (addr.nl_pid != 0 || (msg.msg_flags & MSG_TRUNC)) {
+			continue;
+		}
+
+		struct timespec received{};
+		bool have_timestamp = false;
+
+		for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+			if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+				std::memcpy(&received, CMSG_DATA(cmsg), sizeof(received));
+				have_timestamp = true;
+			}
+		}
+
+		if (!have_timestamp) {
+			::clock_gettime(CLOCK_REALTIME, &received);
+		}
+
+		/* Message format is "<action>@<devpath>\0" followed by "<key>=<value>\0" pairs */
+		buf[len] = '\0';
+
+		std::string action;
+		std::string subsystem;
+		std::string devname;
+
+		for (size_t pos = ::strnlen(buf.data(), len) + 1; pos < (size_t)len; ) {
+			const char *pair = &buf[pos];
+			size_t pair_len = ::strnlen(pair, len - pos);
+
+			if (!std::strncmp(pair, "ACTION=", 7)) {
+				action = pair + 7;
+			} else if (!std::strncmp(pair, "SUBSYSTEM=", 10)) {
+				subsystem = pair + 10;
+			} else if (!std::strncmp(pair, "DEVNAME=", 8)) {
+				devname = pair + 8;
+			}
+
+			pos += pair_len + 1;
+		}
+
+		if (subsystem != "hidraw" || devname.empty()
+				|| devname.find('/') != std::string::npos
+				|| (action != "add" && action != "change")) {
+			continue;
+		}
+
+		auto device = std::make_unique<LinuxHIDDevice>(sysroot_path("/dev/" + devname));
+
+		device->set_event_time(received);
+		identify(std::move(device));
+	}
+}
+
+void LinuxHIDDaemon::log_message(LogLevel level, LogCategory category,
+		LogMessage message, const char *format, const LogArg *args,
+		size_t count) noexcept {
+	vlog(level, category, message, nullptr, format, args, count);
+}
+
+} // namespace hid_identify
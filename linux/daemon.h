@@ -0,0 +1,87 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <time.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../common/log-filter.h"
+#include "../common/log-format.h"
+#include "../common/types.h"
+#include "hid-identify.h"
+#include "unique-fd.h"
+
+namespace hid_identify {
+
+/*
+ * Identify devices that are present at startup and then every device that is
+ * added, using a pool of threads so that a device that is slow to respond
+ * doesn't delay the others or the processing of kernel device events.
+ */
+class LinuxHIDDaemon {
+public:
+	/* Devices are identified using this many threads */
+	explicit LinuxHIDDaemon(unsigned int jobs);
+	~LinuxHIDDaemon();
+
+	int run();
+
+	LinuxHIDDaemon(const LinuxHIDDaemon&) = delete;
+	LinuxHIDDaemon& operator=(const LinuxHIDDaemon&) = delete;
+
+private:
+	void startup();
+	void start_workers();
+	void stop_workers() noexcept;
+	void worker() noexcept;
+	void coldplug();
+	bool process_signal();
+	void process_uevent();
+	void identify(std::unique_ptr<LinuxHIDDevice> device);
+
+	template <class Format, class... Args>
+	void log(LogLevel level, LogCategory category, LogMessage message,
+			Format format, const Args&... args) noexcept {
+		if (log_enabled(level, category)) {
+			LogArgs values{format, args...};
+			log_message(level, category, message, values.format(message), values.data(), values.size());
+		}
+	}
+
+	void log_message(LogLevel level, LogCategory category, LogMessage message,
+		const char *format, const LogArg *args, size_t count) noexcept;
+
+	const unsigned int jobs_;
+	unique_fd signal_fd_;
+	unique_fd uevent_fd_;
+
+	std::vector<std::thread> workers_;
+	std::mutex queue_mutex_;
+	std::condition_variable queue_cv_;
+	std::deque<std::unique_ptr<LinuxHIDDevice>> queue_;
+	bool stopping_ = false;
+};
+
+} // namespace hid_identify
@@ -0,0 +1,84 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "exit-status.h"
+
+#include <sysexits.h>
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "../common/types.h"
+#include "logging.h"
+
+namespace hid_identify {
+
+static int error_exit_status(const Exception &e) noexcept {
+	if (dynamic_cast<const UnavailableDevice*>(&e)) {
+		return EX_NOINPUT;
+	} else if (dynamic_cast<const MalformedHIDReportDescriptor*>(&e)) {
+		return EX_DATAERR;
+	} else if (dynamic_cast<const OSError*>(&e)) {
+		return EX_OSERR;
+	} else if (dynamic_cast<const IOError*>(&e)) {
+		return EX_IOERR;
+	} else if (dynamic_cast<const UnsupportedDevice*>(&e)) {
+		return EX_UNAVAILABLE;
+	} else {
+		return EX_SOFTWARE;
+	}
+}
+
+int exception_exit_status() noexcept {
+#ifdef __cpp_exceptions
+	try {
+		throw;
+	} catch (const Exception &e) {
+		return error_exit_status(e);
+	} catch (...) {
+		return EX_SOFTWARE;
+	}
+#else
+	return EX_SOFTWARE;
+#endif
+}
+
+int rejection_exit_status(Rejection rejection) noexcept {
+	switch (rejection) {
+	case Rejection::NONE:
+		return 0;
+
+	case Rejection::MALFORMED_HID_REPORT_DESCRIPTOR:
+		return EX_DATAERR;
+
+	case Rejection::DISALLOWED_USB_DEVICE:
+	case Rejection::UNSUPPORTED_HID_REPORT_DESCRIPTOR:
+	case Rejection::UNSUPPORTED_HID_REPORT_USAGE:
+		break;
+	}
+
+	return EX_UNAVAILABLE;
+}
+
+void exit_error(const Exception &e) noexcept {
+	/* Other threads may still be running so static destructors can't be used */
+	flush_log();
+	std::fflush(nullptr);
+	std::_Exit(error_exit_status(e));
+}
+
+} // namespace hid_identify
@@ -0,0 +1,33 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include "../common/types.h"
+
+namespace hid_identify {
+
+/*
+ * Convert the exception currently being handled into an exit status from
+ * sysexits.h. Must only be called from within an exception handler.
+ */
+int exception_exit_status() noexcept;
+
+/* Convert the reason a device was rejected into an exit status from sysexits.h */
+int rejection_exit_status(Rejection rejection) noexcept;
+
+} // namespace hid_identify
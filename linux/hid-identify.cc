@@ -1,6 +1,6 @@
 /*
 	qmk-hid-identify - Identify the current OS to QMK device
-	Copyright 2021  Simon Arlott
+	Copyright 2021,2026  Simon Arlott
 
 	This program is free software: you can redistribute it and/or modify
 	it under the terms of the GNU General Public License as published by
@@ -22,16 +22,18 @@
 #include <sys/types.h>
 #include <errno.h>
 #include <fcntl.h>
-#include <string.h>
-#include <syslog.h>
+#include <poll.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <linux/types.h>
 #include <linux/input.h>
 #include <linux/hidraw.h>
 
-#include <cstdarg>
-#include <iostream>
+#include <array>
+#include <chrono>
+#include <climits>
+#include <cstdio>
 #include <string>
 #include <utility>
 #include <vector>
@@ -39,58 +41,80 @@
 #include "../common/hid-device.h"
 #include "../common/types.h"
 #include "hid-report-desc.h"
+#include "logging.h"
+#include "report-cache.h"
+#include "report-desc-scan.h"
+#include "sysfs.h"
+#include "sysroot.h"
 
 namespace hid_identify {
 
-/* POSIX */
-static inline __attribute__((unused)) const char *call_strerror_r(
-		std::vector<char> &buf, int (*func)(int, char *, size_t)) {
-	if (func(errno, buf.data(), buf.size()) == 0) {
-		return buf.data();
-	} else {
-		return nullptr;
-	}
+std::array<uint8_t, 4> os_identity() {
+	return {'L', 'N', 'X', 0};
 }
 
-/* GNU */
-static inline __attribute__((unused)) const char *call_strerror_r(
-		std::vector<char> &buf, char *(*func)(int, char *, size_t)) {
-	return func(errno, buf.data(), buf.size());
+LinuxHIDDevice::LinuxHIDDevice(const std::string &pathname) : pathname_(pathname) {
 }
 
-static std::string get_strerror() {
-	std::vector<char> buf(1024);
-
-	auto ret = call_strerror_r(buf, ::strerror_r);
-	if (ret != nullptr) {
-		return ret;
-	} else {
-		return std::to_string(errno);
-	}
+LinuxHIDDevice::LinuxHIDDevice(const std::string &pathname, unique_fd sysfs_fd, unique_fd fd)
+		: pathname_(pathname), fd_(std::move(fd)), sysfs_fd_(std::move(sysfs_fd)) {
 }
 
-std::vector<uint8_t> os_identity() {
-	return {'L', 'N', 'X', 0};
+LinuxHIDDevice::LinuxHIDDevice(HIDRawSysfsDevice &&device)
+		: pathname_(sysroot_path("/dev/" + device.name)), sysfs_fd_(std::move(device.fd)) {
 }
 
-LinuxHIDDevice::LinuxHIDDevice(const std::string &pathname) : pathname_(pathname) {
+bool LinuxHIDDevice::probe(USBDeviceInfo &device_info) {
+	if (!sysfs_fd_) {
+		struct stat st{};
+
+		if ((fd_ ? ::fstat(fd_.get(), &st) : ::stat(pathname_.c_str(), &st)) < 0
+				|| !S_ISCHR(st.st_mode)) {
+			return false;
+		}
+
+		sysfs_fd_ = HIDRawSysfs::instance().open_device(st.st_rdev);
+		if (!sysfs_fd_) {
+			return false;
+		}
+	}
+
+	if (!HIDRawSysfs::device_info(sysfs_fd_.get(), device_info, name_)) {
+		return false;
+	}
+
+	interface_number_ = device_info.interface_number;
+	return true;
 }
 
-void LinuxHIDDevice::open(USBDeviceInfo &device_info, std::vector<HIDReport> &reports) {
-	if (fd_) {
-		return;
+Rejection LinuxHIDDevice::open(USBDeviceInfo &device_info, HIDReports &reports) {
+	if (initialised_) {
+		return Rejection::NONE;
 	}
 
-	fd_ = unique_fd(::open(pathname_.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC));
 	if (!fd_) {
-		log(LogLevel::ERROR, LogCategory::OS_ERROR, LogMessage::DEV_OS_FUNC_ERROR_CODE_1,
-			2, ::gettext("%s: %s"), "open", get_strerror().c_str());
-		throw UnavailableDevice{};
+		fd_ = unique_fd(::open(pathname_.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC));
+		if (!fd_) {
+			log(LogLevel::ERROR, LogCategory::OS_ERROR, LogMessage::DEV_OS_FUNC_ERROR_CODE_1,
+				LOG_FORMAT("%s: %s"), "open", get_strerror().c_str());
+			throw_error(UnavailableDevice{});
+		}
 	}
+	end_stage(Stage::OPEN);
 
 	init_device_info(device_info);
-	init_reports(reports);
+	end_stage(Stage::IOCTL);
+
+	Rejection rejection = init_reports(reports);
+	end_stage(Stage::PARSE_DESCRIPTOR);
+	if (rejection != Rejection::NONE) {
+		return rejection;
+	}
+
 	init_name();
+	end_stage(Stage::IOCTL);
+	initialised_ = true;
+	return Rejection::NONE;
 }
 
 void LinuxHIDDevice::init_device_info(USBDeviceInfo &device_info) {
@@ -98,118 +122,234 @@ void LinuxHIDDevice::init_device_info(USBDeviceInfo &device_info) {
 
 	if (::ioctl(fd_.get(), HIDIOCGRAWINFO, &info) < 0) {
 		log(LogLevel::ERROR, LogCategory::OS_ERROR, LogMessage::DEV_OS_FUNC_ERROR_CODE_1,
-			2, ::gettext("%s: %s"), "ioctl(HIDIOCGRAWINFO)", get_strerror().c_str());
-		throw OSError{};
+			LOG_FORMAT("%s: %s"), "ioctl(HIDIOCGRAWINFO)", get_strerror().c_str());
+		throw_error(OSError{});
 	}
 
-	device_info = { (uint16_t)info.vendor, (uint16_t)info.product, -1 };
+	device_info = { (uint16_t)info.vendor, (uint16_t)info.product, interface_number_ };
+}
+
+Rejection LinuxHIDDevice::init_reports(HIDReports &reports) {
+	/* Reused for every device instead of allocating it on the stack each time */
+	thread_local struct hidraw_report_descriptor rpt_desc;
+
+	if (!read_report_descriptor_sysfs(rpt_desc)) {
+		read_report_descriptor_ioctl(rpt_desc);
+	}
+	end_stage(Stage::READ_DESCRIPTOR);
+
+	/*
+	 * Most report descriptors don't have the QMK raw HID usage page at all,
+	 * which is quicker to check than looking them up in the cache.
+	 */
+	if (!find_raw_usage_page(rpt_desc.value, rpt_desc.size)) {
+		return Rejection::NONE;
+	}
+
+	auto &cache = HIDReportCache::instance();
+	uint32_t report_count = 0;
+
+	if (cache.lookup(rpt_desc.value, rpt_desc.size, report_count)) {
+		if (report_count > 0) {
+			add_raw_report(reports, report_count);
+		}
+		return Rejection::NONE;
+	}
+
+	/*
+	 * Only the QMK raw HID interface is needed, so stop at the first one
+	 * and skip over the contents of collections for other usage pages.
+	 */
+	HIDReportParser parser{rpt_desc.value, rpt_desc.size};
+	int ret;
+	do {
+		ret = parser.find_next(RAW_USAGE_PAGE, reports);
+		if (ret == 0) {
+			report_count = raw_report_count(reports, reports.size() - 1);
+			if (report_count > 0) {
+				break;
+			}
+
+			reports.pop_back();
+		} else if (ret == -1) {
+			log(LogLevel::WARNING, LogCategory::UNSUPPORTED_DEVICE, LogMessage::DEV_MALFORMED_REPORT_DESCRIPTOR,
+				LOG_FORMAT("Malformed report descriptor"));
+			return Rejection::MALFORMED_HID_REPORT_DESCRIPTOR;
+		}
+	} while (ret != 1);
+
+	/* The device will be rejected because its reports couldn't all be checked */
+	if (!reports.overflow()) {
+		cache.store(rpt_desc.value, rpt_desc.size, report_count);
+	}
+	return Rejection::NONE;
 }
 
-void LinuxHIDDevice::init_reports(std::vector<HIDReport> &reports) {
-	struct hidraw_report_descriptor rpt_desc{};
+bool LinuxHIDDevice::read_report_descriptor_sysfs(struct hidraw_report_descriptor &rpt_desc) {
+	if (!sysfs_fd_) {
+		return false;
+	}
+
+	ssize_t len = HIDRawSysfs::report_descriptor(sysfs_fd_.get(),
+		rpt_desc.value, sizeof(rpt_desc.value));
+	if (len <= 0) {
+		return false;
+	}
+
+	rpt_desc.size = len;
+	return true;
+}
+
+void LinuxHIDDevice::read_report_descriptor_ioctl(struct hidraw_report_descriptor &rpt_desc) {
 	int desc_size = 0;
 
 	if (::ioctl(fd_.get(), HIDIOCGRDESCSIZE, &desc_size) < 0) {
 		log(LogLevel::ERROR, LogCategory::OS_ERROR, LogMessage::DEV_OS_FUNC_ERROR_CODE_1,
-			2, ::gettext("%s: %s"), "ioctl(HIDIOCGRDESCSIZE)", get_strerror().c_str());
-		throw OSError{};
+			LOG_FORMAT("%s: %s"), "ioctl(HIDIOCGRDESCSIZE)", get_strerror().c_str());
+		throw_error(OSError{});
 	}
 
 	if (desc_size < 0) {
 		log(LogLevel::ERROR, LogCategory::OS_ERROR, LogMessage::DEV_REPORT_DESCRIPTOR_SIZE_NEGATIVE,
-			1, ::gettext("Report descriptor size is negative (%s)"),
-			std::to_string(desc_size).c_str());
-		throw OSLengthError{};
+			LOG_FORMAT("Report descriptor size is negative (%s)"),
+			desc_size);
+		throw_error(OSLengthError{});
 	} else if ((unsigned int)desc_size > sizeof(rpt_desc.value)) {
 		log(LogLevel::ERROR, LogCategory::OS_ERROR, LogMessage::DEV_REPORT_DESCRIPTOR_SIZE_TOO_LARGE,
-			2, ::gettext("Report descriptor size too large (%s > %s)"),
-			std::to_string(desc_size).c_str(), std::to_string(sizeof(rpt_desc.value)).c_str());
-		throw OSLengthError{};
+			LOG_FORMAT("Report descriptor size too large (%s > %s)"),
+			desc_size, sizeof(rpt_desc.value));
+		throw_error(OSLengthError{});
 	}
 
 	rpt_desc.size = desc_size;
 	if (::ioctl(fd_.get(), HIDIOCGRDESC, &rpt_desc) < 0) {
 		log(LogLevel::ERROR, LogCategory::OS_ERROR, LogMessage::DEV_OS_FUNC_ERROR_CODE_1,
-			2, ::gettext("%s: %s"), "ioctl(HIDIOCGRDESC)", get_strerror().c_str());
-		throw OSError{};
+			LOG_FORMAT("%s: %s"), "ioctl(HIDIOCGRDESC)", get_strerror().c_str());
+		throw_error(OSError{});
 	}
-
-	unsigned int pos = 0;
-	int ret;
-	do {
-		HIDReport hid_report{};
-
-		ret = get_next_hid_usage(rpt_desc.value, rpt_desc.size, &pos, hid_report);
-		if (ret == 0) {
-			reports.emplace_back(std::move(hid_report));
-		} else if (ret == -1) {
-			log(LogLevel::WARNING, LogCategory::UNSUPPORTED_DEVICE, LogMessage::DEV_MALFORMED_REPORT_DESCRIPTOR,
-				0, ::gettext("Malformed report descriptor"));
-			throw MalformedHIDReportDescriptor{};
-		}
-	} while (ret != 0);
 }
 
 void LinuxHIDDevice::init_name() {
-	std::vector<char> buf(256);
+	if (name_[0]) {
+		/* Already read from sysfs */
+		return;
+	}
 
-	if (::ioctl(fd_.get(), HIDIOCGRAWPHYS(buf.size()), buf.data()) < 0) {
+	if (::ioctl(fd_.get(), HIDIOCGRAWPHYS(name_.size()), name_.data()) < 0) {
 		log(LogLevel::WARNING, LogCategory::OS_ERROR, LogMessage::DEV_OS_FUNC_ERROR_CODE_1,
-			2, ::gettext("%s: %s"), "ioctl(HIDIOCGRAWPHYS)", get_strerror().c_str());
-		name_.clear();
+			LOG_FORMAT("%s: %s"), "ioctl(HIDIOCGRAWPHYS)", get_strerror().c_str());
+		name_[0] = '\0';
 	} else {
-		name_ = buf.data();
+		name_.back() = '\0';
 	}
 }
 
 void LinuxHIDDevice::reset() noexcept {
 	fd_.clear();
-	name_.clear();
+	initialised_ = false;
+	sysfs_fd_.clear();
+	interface_number_ = -1;
+	name_[0] = '\0';
 	report_count_ = 0;
 }
 
-void LinuxHIDDevice::log(LogLevel level,
-		LogCategory category __attribute__((unused)),
-		LogMessage message __attribute__((unused)),
-		int argc __attribute__((unused)),
-		const char *format...) noexcept {
-	std::string prefix = pathname_;
+void LinuxHIDDevice::log_message(LogLevel level, LogCategory category,
+		LogMessage message, const char *format, const LogArg *args,
+		size_t count) noexcept {
+	const USBDeviceInfo &info = device_info();
+	LogDevice device{pathname_.c_str(), name_.data(),
+		(info.vendor || info.product) ? &info : nullptr};
 
-	if (!name_.empty()) {
-		prefix += " (" + name_ + ")";
-	}
+	vlog(level, category, message, &device, format, args, count);
+}
+
+void LinuxHIDDevice::send_report(const uint8_t *data, size_t length) {
+	auto timeout = std::chrono::steady_clock::now() + WRITE_TIMEOUT;
 
-	std::vector<char> text(256);
-	std::va_list args;
+	while (!try_send_report(data, length)) {
+		auto remaining_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+			timeout - std::chrono::steady_clock::now()).count();
+		struct pollfd pfd{};
 
-	va_start(args, format);
-	if (std::vsnprintf(text.data(), text.size(), format, args) < 0) {
-		text[0] = '?';
-		text[1] = '\0';
+		pfd.fd = fd_.get();
+		pfd.events = POLLOUT;
+
+		int ret = ::poll(&pfd, 1, remaining_ms > 0 ? remaining_ms : 0);
+		if (ret < 0 && errno != EINTR) {
+			log(LogLevel::ERROR, LogCategory::IO_ERROR, LogMessage::DEV_OS_FUNC_ERROR_CODE_1,
+				LOG_FORMAT("%s: %s"), "poll", get_strerror().c_str());
+			throw_error(IOError{});
+		} else if (ret == 0) {
+			report_timeout();
+		}
 	}
-	va_end(args);
+}
 
-	::syslog(LOG_USER | static_cast<int>(level), "%s: %s", prefix.c_str(), text.data());
+bool LinuxHIDDevice::try_send_report(const uint8_t *data, size_t length) {
+	ssize_t ret = ::write(fd_.get(), data, length);
 
-	if (level >= LogLevel::INFO) {
-		std::cout << prefix << ": " << text.data() << std::endl;
-	} else {
-		std::cerr << prefix << ": " << text.data() << std::endl;
+	return write_result(ret < 0 ? -errno : ret, length);
+}
+
+void LinuxHIDDevice::report_written(ssize_t ret) {
+	if (ret == -ECANCELED) {
+		report_timeout();
+	} else if (!write_result(ret, report_length())) {
+		/* The device is non-blocking, so wait until it can be written to */
+		send_report(report(), report_length());
 	}
+
+	report_sent();
 }
 
-void LinuxHIDDevice::send_report(std::vector<uint8_t> &data) {
-	ssize_t ret = ::write(fd_.get(), data.data(), data.size());
+bool LinuxHIDDevice::write_result(ssize_t ret, size_t length) {
 	if (ret < 0) {
+		if (ret == -EAGAIN || ret == -EINTR) {
+			return false;
+		}
+
+		errno = -ret;
 		log(LogLevel::ERROR, LogCategory::IO_ERROR, LogMessage::DEV_WRITE_FAILED,
-			1, ::gettext("write: %s"), get_strerror().c_str());
-		throw IOError{};
-	} else if ((size_t)ret != data.size()) {
+			LOG_FORMAT("write: %s"), get_strerror().c_str());
+		throw_error(IOError{});
+	} else if ((size_t)ret != length) {
 		log(LogLevel::ERROR, LogCategory::IO_ERROR, LogMessage::DEV_SHORT_WRITE,
-			2, ::gettext("Write completed with only %s of %s bytes written"),
-			std::to_string(ret).c_str(), std::to_string(data.size()).c_str());
-		throw IOError{};
+			LOG_FORMAT("Write completed with only %s of %s bytes written"),
+			ret, length);
+		throw_error(IOError{});
+	}
+
+	return true;
+}
+
+void LinuxHIDDevice::set_event_time(const struct timespec &received) {
+	event_time_ = received;
+	has_event_time_ = true;
+}
+
+void LinuxHIDDevice::report_sent() {
+	if (!has_event_time_) {
+		HIDDevice::report_sent();
+		return;
 	}
+
+	struct timespec now{};
+	::clock_gettime(CLOCK_REALTIME, &now);
+
+	double latency_ms = (now.tv_sec - event_time_.tv_sec) * 1000.0
+		+ (now.tv_nsec - event_time_.tv_nsec) / 1000000.0;
+	std::array<char, 32> latency;
+
+	std::snprintf(latency.data(), latency.size(), "%.3f", latency_ms);
+
+	log(LogLevel::INFO, LogCategory::REPORT_SENT, LogMessage::DEV_REPORT_SENT_LATENCY,
+		LOG_FORMAT("Report sent %s ms after device event"), latency.data());
+}
+
+void LinuxHIDDevice::report_timeout() {
+	log(LogLevel::ERROR, LogCategory::IO_ERROR, LogMessage::DEV_WRITE_TIMEOUT,
+		LOG_FORMAT("Report send timed out"));
+	throw_error(IOError{});
 }
 
 } /* namespace hid_identify */
@@ -1,6 +1,6 @@
 /*
 	qmk-hid-identify - Identify the current OS to QMK device
-	Copyright 2021  Simon Arlott
+	Copyright 2021,2026  Simon Arlott
 
 	This program is free software: you can redistribute it and/or modify
 	it under the terms of the GNU General Public License as published by
@@ -17,37 +17,79 @@
 */
 #pragma once
 
+#include <sys/types.h>
+#include <time.h>
+
+#include <linux/hidraw.h>
+
+#include <array>
+#include <chrono>
 #include <cstdint>
 #include <string>
 #include <vector>
 
 #include "../common/hid-device.h"
 #include "../common/types.h"
+#include "sysfs.h"
 #include "unique-fd.h"
 
 namespace hid_identify {
 
 class LinuxHIDDevice: public HIDDevice {
 public:
+	static constexpr std::chrono::milliseconds WRITE_TIMEOUT{1000};
+
 	explicit LinuxHIDDevice(const std::string &pathname);
+	/*
+	 * Use a sysfs device directory and device that have already been opened,
+	 * either of which can be empty.
+	 */
+	LinuxHIDDevice(const std::string &pathname, unique_fd sysfs_fd, unique_fd fd);
+	explicit LinuxHIDDevice(HIDRawSysfsDevice &&device);
+
+	int fd() const { return fd_.get(); }
+
+	/*
+	 * Log the time between the kernel device event (CLOCK_REALTIME) and the
+	 * report being sent.
+	 */
+	void set_event_time(const struct timespec &received);
+	void report_timeout();
+
+	/*
+	 * Complete sending a report that was written externally, with the
+	 * result of the write (or -errno).
+	 */
+	void report_written(ssize_t ret);
 
 protected:
-	void log(LogLevel level, LogCategory category, LogMessage message,
-		int argc, const char *format...) noexcept override;
+	void log_message(LogLevel level, LogCategory category, LogMessage message,
+		const char *format, const LogArg *args, size_t count) noexcept override;
 
-	void open(USBDeviceInfo &device_info, std::vector<HIDReport> &reports) override;
-	void send_report(std::vector<uint8_t> &data) override;
+	bool probe(USBDeviceInfo &device_info) override;
+	Rejection open(USBDeviceInfo &device_info, HIDReports &reports) override;
+	void send_report(const uint8_t *data, size_t length) override;
 	void reset() noexcept override;
+	void report_sent() override;
 
 private:
+	bool try_send_report(const uint8_t *data, size_t length);
 	void init_device_info(USBDeviceInfo &device_info);
-	void init_reports(std::vector<HIDReport> &reports);
+	Rejection init_reports(HIDReports &reports);
+	bool read_report_descriptor_sysfs(struct hidraw_report_descriptor &rpt_desc);
+	void read_report_descriptor_ioctl(struct hidraw_report_descriptor &rpt_desc);
 	void init_name();
+	bool write_result(ssize_t ret, size_t length);
 
 	const std::string pathname_;
 	unique_fd fd_;
-	std::string name_;
+	bool initialised_ = false;
+	unique_fd sysfs_fd_;
+	int16_t interface_number_ = -1;
+	std::array<char, HID_PHYS_SIZE> name_{};
 	uint32_t report_count_ = 0;
+	bool has_event_time_ = false;
+	struct timespec event_time_{};
 };
 
 } // namespace hid_identify
@@ -1,6 +1,6 @@
 /*
 	qmk-hid-identify - Identify the current OS to QMK device
-	Copyright 2021  Simon Arlott
+	Copyright 2021,2026  Simon Arlott
 
 	This program is free software: you can redistribute it and/or modify
 	it under the terms of the GNU General Public License as published by
@@ -15,7 +15,7 @@
 	You should have received a copy of the GNU General Public License
 	along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
-// Modified from https://github.com/libusb/hidapi
+// Based on https://github.com/libusb/hidapi
 // commit 6a01f3b4a8862b19a7ec768752ebcfc1a412f4b1 hidapi/linux/hid.c
 /*******************************************************
  HIDAPI - Multi-Platform library for
@@ -42,233 +42,279 @@
 
 #include "hid-report-desc.h"
 
+#include <array>
+#include <cstddef>
 #include <cstdint>
 
 namespace hid_identify {
 
-/*
- * Gets the size of the HID item at the given position
- * Returns 1 if successful, 0 if an invalid key
- * Sets data_len and key_size when successful
- */
-static int get_hid_item_size(uint8_t *report_descriptor, unsigned int pos, size_t size, int *data_len, int *key_size)
-{
-	int key = report_descriptor[pos];
-	int size_code;
-
-	/*
-	 * This is a Long Item. The next byte contains the
-	 * length of the data section (value) for this key.
-	 * See the HID specification, version 1.11, section
-	 * 6.2.2.3, titled "Long Items."
-	 */
-	if ((key & 0xf0) == 0xf0) {
-		if (pos + 1 < size)
-		{
-			*data_len = report_descriptor[pos + 1];
-			*key_size = 3;
-			return 1;
-		}
-		*data_len = 0; /* malformed report */
-		*key_size = 0;
+/* Main item tags (6.2.2.4) */
+static constexpr uint8_t MAIN_INPUT = 0x8;
+static constexpr uint8_t MAIN_OUTPUT = 0x9;
+static constexpr uint8_t MAIN_COLLECTION = 0xa;
+static constexpr uint8_t MAIN_FEATURE = 0xb;
+static constexpr uint8_t MAIN_END_COLLECTION = 0xc;
+
+/* Global item tags (6.2.2.7) */
+static constexpr uint8_t GLOBAL_USAGE_PAGE = 0x0;
+static constexpr uint8_t GLOBAL_LOGICAL_MINIMUM = 0x1;
+static constexpr uint8_t GLOBAL_LOGICAL_MAXIMUM = 0x2;
+static constexpr uint8_t GLOBAL_REPORT_SIZE = 0x7;
+static constexpr uint8_t GLOBAL_REPORT_COUNT = 0x9;
+static constexpr uint8_t GLOBAL_PUSH = 0xa;
+static constexpr uint8_t GLOBAL_POP = 0xb;
+
+/* Local item tags (6.2.2.8) */
+static constexpr uint8_t LOCAL_USAGE = 0x0;
+
+static constexpr std::array<HIDItemPrefix, 256> make_item_prefixes() {
+	std::array<HIDItemPrefix, 256> prefixes{};
+
+	for (unsigned int i = 0; i < prefixes.size(); i++) {
+		/* Short items (6.2.2.2) have a size code of 0, 1, 2 or 4 bytes */
+		uint8_t size = (i & 0x3) == 3 ? 4 : (i & 0x3);
+
+		prefixes[i] = {
+			static_cast<HIDItemType>((i >> 2) & 0x3),
+			static_cast<uint8_t>(i >> 4),
+			static_cast<uint8_t>(1 + size),
+			size == 4 ? UINT32_MAX : (UINT32_C(1) << (size * 8)) - 1,
+		};
 	}
 
-	/*
-	 * This is a Short Item. The bottom two bits of the
-	 * key contain the size code for the data section
-	 * (value) for this key. Refer to the HID
-	 * specification, version 1.11, section 6.2.2.2,
-	 * titled "Short Items."
-	 */
-	size_code = key & 0x3;
-	switch (size_code) {
-	case 0:
-	case 1:
-	case 2:
-		*data_len = size_code;
-		*key_size = 1;
-		return 1;
-	case 3:
-		*data_len = 4;
-		*key_size = 1;
-		return 1;
-	default:
-		/* Can't ever happen since size_code is & 0x3 */
-		*data_len = 0;
-		*key_size = 0;
-		break;
-	};
-
-	/* malformed report */
-	return 0;
+	/* Long items (6.2.2.3) have a prefix of 0xFE */
+	prefixes[0xfe] = { HIDItemType::LONG, 0, 0, 0 };
+	return prefixes;
 }
 
+constexpr std::array<HIDItemPrefix, 256> HID_ITEM_PREFIXES = make_item_prefixes();
+
 /*
- * Get bytes from a HID Report Descriptor.
- * Only call with a num_bytes of 0, 1, 2, or 4.
+ * Updates the global state, returning false if the global item stack
+ * overflows or underflows.
  */
-static uint32_t get_hid_report_bytes(uint8_t *rpt, size_t len, size_t num_bytes, size_t cur)
+inline bool HIDReportParser::global_item(const HIDItem &item)
 {
-	/* Return if there aren't enough bytes. */
-	if (cur + num_bytes >= len)
-		return 0;
-
-	if (num_bytes == 0)
-		return 0;
-	else if (num_bytes == 1)
-		return rpt[cur + 1];
-	else if (num_bytes == 2)
-		return (rpt[cur + 2] * 256 + rpt[cur + 1]);
-	else if (num_bytes == 4)
-		return (
-			rpt[cur + 4] * 0x01000000 +
-			rpt[cur + 3] * 0x00010000 +
-			rpt[cur + 2] * 0x00000100 +
-			rpt[cur + 1] * 0x00000001
-		);
-	else
-		return 0;
+	switch (item.tag) {
+	case GLOBAL_USAGE_PAGE:
+		global_.usage_page = item.value;
+		global_.has_usage_page = true;
+		break;
+
+	case GLOBAL_LOGICAL_MINIMUM:
+		global_.values.minimum = item.value;
+		global_.values.flags |= HIDCollection::HAS_MINIMUM;
+		break;
+
+	case GLOBAL_LOGICAL_MAXIMUM:
+		global_.values.maximum = item.value;
+		global_.values.flags |= HIDCollection::HAS_MAXIMUM;
+		break;
+
+	case GLOBAL_REPORT_SIZE:
+		global_.values.size = item.value;
+		global_.values.flags |= HIDCollection::HAS_SIZE;
+		break;
+
+	case GLOBAL_REPORT_COUNT:
+		global_.values.count = item.value;
+		global_.values.flags |= HIDCollection::HAS_COUNT;
+		break;
+
+	case GLOBAL_PUSH:
+		if (global_stack_depth_ == global_stack_.size())
+			return false;
+
+		global_stack_[global_stack_depth_++] = global_;
+		break;
+
+	case GLOBAL_POP:
+		if (global_stack_depth_ == 0)
+			return false;
+
+		global_ = global_stack_[--global_stack_depth_];
+		break;
+	}
+
+	return true;
 }
 
 /*
- * Retrieves the device's Usage Page and Usage from the report descriptor.
- * The algorithm returns the current Usage Page/Usage pair whenever a new
- * Collection is found and a Usage Local Item is currently in scope.
- * Usage Local Items are consumed by each Main Item (See. 6.2.2.8).
- * The algorithm should give similar results as Apple's:
- *   https://developer.apple.com/documentation/iokit/kiohiddeviceusagepairskey?language=objc
- * Physical Collections are also matched (macOS does the same).
+ * Skips over the rest of a top-level collection, only keeping track of the
+ * global state and nested collections.
  *
- * This function can be called repeatedly until it returns non-0
- * Usage is found. pos is the starting point (initially 0) and will be updated
- * to the next search position.
- *
- * The return value is 0 when a pair is found.
- * 1 when finished processing descriptor.
+ * The return value is 1 at the end of the collection.
  * -1 on a malformed report.
  */
-int get_next_hid_usage(uint8_t *report_descriptor, size_t size, unsigned int *pos, HIDReport &hid_report)
+int HIDReportParser::skip_collection()
 {
-	int data_len, key_size;
-	int initial = *pos == 0; /* Used to handle case where no top-level application collection is defined */
-	bool usage_pair_ready = 0;
-	bool usage_page_found = false;
-
-	/* Usage is a Local Item, it must be set before each Main Item (Collection) before a pair is returned */
-	bool collection = false;
-
-	struct HIDCollection tmp{};
-	hid_report = {};
-
-	while (*pos < size) {
-		int key = report_descriptor[*pos];
-		int key_cmd = key & 0xfc;
-
-		/* Determine data_len and key_size */
-		if (!get_hid_item_size(report_descriptor, *pos, size, &data_len, &key_size))
-			return -1; /* malformed report */
-
-		switch (key_cmd) {
-		case 0x4: /* Usage Page 6.2.2.7 (Global) */
-			if (!collection) {
-				hid_report.usage_page = get_hid_report_bytes(report_descriptor, size, data_len, *pos);
-				usage_page_found = true;
+	unsigned int depth = 1;
+	HIDItem item;
+	int ret;
+
+	while ((ret = items_.next(item)) == 1) {
+		if (item.type == HIDItemType::GLOBAL) {
+			if (!global_item(item))
+				return -1; /* malformed report */
+		} else if (item.type == HIDItemType::MAIN) {
+			if (item.tag == MAIN_COLLECTION) {
+				depth++;
+			} else if (item.tag == MAIN_END_COLLECTION) {
+				if (--depth == 0)
+					return 1;
 			}
-			break;
+		}
+	}
 
-		case 0x8: /* Usage 6.2.2.8 (Local) */
-			tmp.usage = get_hid_report_bytes(report_descriptor, size, data_len, *pos);
-			tmp.has_usage = true;
-			break;
+	/* The collection must end before the end of the descriptor */
+	return -1;
+}
 
-		case 0xa0: /* Collection 6.2.2.4 (Main) */
-			collection = true;
+int HIDReportParser::next(HIDReports &reports, const uint32_t *usage_page)
+{
+	HIDItemIterator items = items_;
+	HIDItem item;
+	int ret;
+	unsigned int depth = 0;
+	bool usage_pair_ready = false;
 
-			/* A Usage Item (Local) must be found for the pair to be valid */
-			if (usage_page_found && tmp.has_usage) {
-				hid_report.usage = tmp.usage;
-				usage_pair_ready = true;
-			}
+	/* Usage is a Local Item, it must be set before each Main Item (Collection) before a pair is returned */
+	bool has_usage = false;
+	uint32_t usage = 0;
+
+	while ((ret = items.next(item)) == 1) {
+		switch (item.type) {
+		case HIDItemType::GLOBAL:
+			if (!global_item(item))
+				goto malformed;
 			break;
 
-		case 0x14: /* Usage Minimum (Local) */
-			if (collection) {
-				tmp.minimum = get_hid_report_bytes(report_descriptor, size, data_len, *pos);
-				tmp.has_minimum = true;
+		case HIDItemType::LOCAL:
+			if (item.tag == LOCAL_USAGE) {
+				usage = item.value;
+				has_usage = true;
 			}
 			break;
 
-		case 0x24: /* Usage Maximum (Local) */
-			if (collection) {
-				tmp.maximum = get_hid_report_bytes(report_descriptor, size, data_len, *pos);
-				tmp.has_maximum = true;
-			}
-			break;
+		case HIDItemType::MAIN:
+			switch (item.tag) {
+			case MAIN_COLLECTION:
+				collection_found_ = true;
+
+				/* Each top-level collection is a report */
+				if (depth++ == 0)
+					reports.add_report();
+
+				/* A Usage Item (Local) must be found for the pair to be valid */
+				if (!usage_pair_ready && global_.has_usage_page && has_usage) {
+					reports.set_usage(global_.usage_page, usage);
+					usage_pair_ready = true;
+
+					/*
+					 * Nothing else in this collection can change the pair,
+					 * so if it's not the one being looked for then only the
+					 * global state is needed from the rest of it.
+					 */
+					if (depth == 1 && usage_page != nullptr && global_.usage_page != *usage_page) {
+						items_ = items;
+						ret = skip_collection();
+						items = items_;
+						if (ret == -1)
+							goto malformed;
+
+						depth = 0;
+						usage_pair_ready = false;
+						reports.pop_back();
+					}
+				}
+				break;
 
-		case 0x74: /* Report Size (Local) */
-			if (collection) {
-				tmp.size = get_hid_report_bytes(report_descriptor, size, data_len, *pos);
-				tmp.has_size = true;
-			}
-			break;
+			case MAIN_INPUT:
+			case MAIN_OUTPUT:
+			case MAIN_FEATURE:
+				if (depth > 0) {
+					HIDCollection values = global_.values;
+
+					if (has_usage) {
+						values.flags |= HIDCollection::HAS_USAGE;
+						values.usage = usage;
+					}
+
+					reports.add_item(item.tag == MAIN_INPUT ? HIDReportType::INPUT
+						: (item.tag == MAIN_OUTPUT ? HIDReportType::OUTPUT
+							: HIDReportType::FEATURE), values);
+				}
+				break;
 
-		case 0x94: /* Report Count (Local) */
-			if (collection) {
-				tmp.count = get_hid_report_bytes(report_descriptor, size, data_len, *pos);
-				tmp.has_count = true;
-			}
-			break;
+			case MAIN_END_COLLECTION:
+				if (depth == 0)
+					goto malformed;
 
-		case 0x80: /* Input 6.2.2.4 (Main) */
-			if (collection) {
-				hid_report.in.emplace_back(tmp);
-			}
-			break;
+				/* Return usage pair at the end of the top-level collection */
+				if (--depth == 0) {
+					if (usage_pair_ready) {
+						items_ = items;
+						return 0;
+					}
 
-		case 0x90: /* Output 6.2.2.4 (Main) */
-			if (collection) {
-				hid_report.out.emplace_back(tmp);
+					reports.pop_back();
+				}
+				break;
 			}
-			break;
 
-		case 0xb0: /* Feature 6.2.2.4 (Main) */
-			if (collection) {
-				hid_report.feature.emplace_back(tmp);
-			}
+			/* Usage is a Local Item, unset it */
+			has_usage = false;
 			break;
 
-		case 0xc0: /* End Collection 6.2.2.4 (Main) */
-			/* Return usage pair */
-			if (collection && usage_pair_ready) {
-				return 0;
-			}
-
-			collection = false;
-			usage_pair_ready = false;
+		case HIDItemType::RESERVED:
+		case HIDItemType::LONG:
 			break;
 		}
+	}
 
-		switch (key_cmd) {
-			case 0x80: /* Input 6.2.2.4 (Main) */
-			case 0x90: /* Output 6.2.2.4 (Main) */
-			case 0xa0: /* Collection 6.2.2.4 (Main) */
-			case 0xb0: /* Feature 6.2.2.4 (Main) */
-			case 0xc0: /* End Collection 6.2.2.4 (Main) */
-				/* Usage is a Local Item, unset it */
-				tmp = {};
-				break;
-		}
+	items_ = items;
 
-		/* Skip over this key and it's associated data */
-		*pos += data_len + key_size;
-	}
+	if (ret == -1 || depth > 0)
+		goto malformed;
 
 	/* If no top-level application collection is found and usage page/usage pair is found, pair is valid
 	   https://docs.microsoft.com/en-us/windows-hardware/drivers/hid/top-level-collections */
-	if (initial && usage_page_found && tmp.has_usage)
+	if (!collection_found_ && global_.has_usage_page && has_usage) {
+		reports.add_report();
+		reports.set_usage(global_.usage_page, usage);
+
+		/* Only return this pair once */
+		collection_found_ = true;
 		return 0; /* success */
+	}
 
 	return 1; /* finished processing */
+
+malformed:
+	/* Remove the incomplete report */
+	if (depth > 0)
+		reports.pop_back();
+
+	return -1; /* malformed report */
+}
+
+int HIDReportParser::next(HIDReports &reports)
+{
+	return next(reports, nullptr);
+}
+
+int HIDReportParser::find_next(uint32_t usage_page, HIDReports &reports)
+{
+	int ret;
+
+	while ((ret = next(reports, &usage_page)) == 0) {
+		if (reports.usage_page(reports.size() - 1) == usage_page)
+			break;
+
+		reports.pop_back();
+	}
+
+	return ret;
 }
 
 } // namespace hid_identify
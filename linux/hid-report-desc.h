@@ -1,6 +1,6 @@
 /*
 	qmk-hid-identify - Identify the current OS to QMK device
-	Copyright 2021  Simon Arlott
+	Copyright 2021,2026  Simon Arlott
 
 	This program is free software: you can redistribute it and/or modify
 	it under the terms of the GNU General Public License as published by
@@ -15,7 +15,7 @@
 	You should have received a copy of the GNU General Public License
 	along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
-// Modified from https://github.com/libusb/hidapi
+// Based on https://github.com/libusb/hidapi
 // commit 6a01f3b4a8862b19a7ec768752ebcfc1a412f4b1 hidapi/linux/hid.c
 /*******************************************************
  HIDAPI - Multi-Platform library for
@@ -41,15 +41,113 @@
 ********************************************************/
 #pragma once
 
+#include <endian.h>
+
+#include <array>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 
 #include "../common/types.h"
 
 namespace hid_identify {
 
+enum class HIDItemType : uint8_t {
+	MAIN = 0,
+	GLOBAL = 1,
+	LOCAL = 2,
+	RESERVED = 3,
+	LONG = 4,
+};
+
+/* An item in a report descriptor */
+struct HIDItem {
+	unsigned int pos;    /* Position of the item's prefix */
+	unsigned int length; /* Length of the item including its prefix */
+	HIDItemType type;
+	uint8_t tag;
+	uint32_t value;      /* Data of a short item (unsigned, little endian) */
+};
+
+/* Type, tag and length of an item from its prefix */
+struct HIDItemPrefix {
+	HIDItemType type;
+	uint8_t tag;
+	uint8_t length;
+	uint32_t mask;       /* Bits of the 4 bytes after the prefix that are data */
+};
+
+/* Lookup table for the first byte of every item */
+extern const std::array<HIDItemPrefix, 256> HID_ITEM_PREFIXES;
+
 /*
- * Retrieves the device's Usage Page and Usage from the report descriptor.
+ * Iterates over the items in a report descriptor, using a lookup table to
+ * decode the prefix of each item.
+ */
+class HIDItemIterator {
+public:
+	HIDItemIterator(const uint8_t *report_descriptor, size_t size)
+		: report_descriptor_(report_descriptor), size_(size) {}
+
+	/*
+	 * Get the next item and move past it.
+	 *
+	 * The return value is 1 when an item is found.
+	 * 0 when finished processing descriptor.
+	 * -1 if the item is truncated.
+	 */
+	int next(HIDItem &item) {
+		if (pos_ >= size_)
+			return 0; /* finished processing */
+
+		const uint8_t *data = &report_descriptor_[pos_];
+		const HIDItemPrefix &prefix = HID_ITEM_PREFIXES[data[0]];
+		size_t remaining = size_ - pos_;
+
+		item.pos = pos_;
+		item.type = prefix.type;
+		item.tag = prefix.tag;
+		item.length = prefix.length;
+
+		if (remaining > sizeof(uint32_t) && prefix.type != HIDItemType::LONG) {
+			/* Always read 4 bytes and discard the ones that aren't data */
+			uint32_t value;
+
+			std::memcpy(&value, &data[1], sizeof(value));
+			item.value = le32toh(value) & prefix.mask;
+		} else if (prefix.type == HIDItemType::LONG) {
+			/* The data size and tag are in the next two bytes */
+			if (remaining < 3 || remaining < 3U + data[1])
+				return -1; /* malformed report */
+
+			item.tag = data[2];
+			item.length = 3 + data[1];
+			item.value = 0;
+		} else {
+			/* Near the end of the report descriptor */
+			if (remaining < item.length)
+				return -1; /* malformed report */
+
+			item.value = 0;
+			for (unsigned int i = 1; i < item.length; i++)
+				item.value |= static_cast<uint32_t>(data[i]) << ((i - 1) * 8);
+		}
+
+		pos_ += item.length;
+		return 1;
+	}
+
+	/* Position of the next item */
+	unsigned int pos() const { return pos_; }
+
+private:
+	const uint8_t *report_descriptor_;
+	size_t size_;
+	unsigned int pos_ = 0;
+};
+
+/*
+ * Retrieves the device's Usage Page and Usage pairs from the report descriptor.
  * The algorithm returns the current Usage Page/Usage pair whenever a new
  * Collection is found and a Usage Local Item is currently in scope.
  * Usage Local Items are consumed by each Main Item (See. 6.2.2.8).
@@ -57,14 +155,55 @@ namespace hid_identify {
  *   https://developer.apple.com/documentation/iokit/kiohiddeviceusagepairskey?language=objc
  * Physical Collections are also matched (macOS does the same).
  *
- * This function can be called repeatedly until it returns non-0
- * Usage is found. pos is the starting point (initially 0) and will be updated
- * to the next search position.
- *
- * The return value is 0 when a pair is found.
- * 1 when finished processing descriptor.
- * -1 on a malformed report.
+ * The Input, Output and Feature items of each pair are those up to the end of
+ * its top-level collection. Global items (including Push and Pop) apply to all
+ * of the items that follow them, as in the HID specification.
  */
-int get_next_hid_usage(uint8_t *report_descriptor, size_t size, unsigned int *pos, HIDReport &hid_report);
+class HIDReportParser {
+public:
+	HIDReportParser(const uint8_t *report_descriptor, size_t size)
+		: items_(report_descriptor, size) {}
+
+	/*
+	 * Get the next Usage Page/Usage pair, adding it to the end of reports.
+	 * This can be called repeatedly until it returns non-0.
+	 *
+	 * The return value is 0 when a pair is found.
+	 * 1 when finished processing descriptor.
+	 * -1 on a malformed report.
+	 */
+	int next(HIDReports &reports);
+
+	/*
+	 * Get the next Usage Page/Usage pair with a specific Usage Page, with the
+	 * same results as calling next() until it finds one.
+	 *
+	 * The Input, Output and Feature items of top-level collections for any
+	 * other Usage Page are skipped over without decoding them, so this is much
+	 * faster when the pair being looked for is in a composite report
+	 * descriptor.
+	 */
+	int find_next(uint32_t usage_page, HIDReports &reports);
+
+private:
+	/* Same maximum depth as the Linux kernel */
+	static constexpr size_t GLOBAL_STACK_SIZE = 4;
+
+	struct GlobalState {
+		bool has_usage_page;
+		uint32_t usage_page;
+		HIDCollection values; /* Everything except the usage */
+	};
+
+	int next(HIDReports &reports, const uint32_t *usage_page);
+	bool global_item(const HIDItem &item);
+	int skip_collection();
+
+	HIDItemIterator items_;
+	GlobalState global_{};
+	std::array<GlobalState, GLOBAL_STACK_SIZE> global_stack_;
+	size_t global_stack_depth_ = 0;
+	bool collection_found_ = false;
+};
 
 } // namespace hid_identify
@@ -0,0 +1,247 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "hid-uring.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <liburing.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../common/hid-device.h"
+#include "../common/types.h"
+#include "exit-status.h"
+#include "hid-identify.h"
+#include "logging.h"
+#include "sysfs.h"
+#include "unique-fd.h"
+
+namespace hid_identify {
+
+static constexpr size_t BATCH_SIZE = 32;
+/* Each write has a linked timeout */
+static constexpr unsigned int QUEUE_DEPTH = BATCH_SIZE * 2;
+static constexpr uint64_t LINK_TIMEOUT_DATA = UINT64_MAX;
+
+LinuxHIDUring::LinuxHIDUring() {
+	initialised_ = ::io_uring_queue_init(QUEUE_DEPTH, &ring_, 0) == 0;
+}
+
+LinuxHIDUring::~LinuxHIDUring() {
+	if (initialised_) {
+		::io_uring_queue_exit(&ring_);
+	}
+}
+
+void LinuxHIDUring::add(const std::string &pathname) {
+	devices_.push_back({pathname, nullptr, 0, unique_fd{}, true});
+}
+
+std::vector<int> LinuxHIDUring::run() {
+	for (size_t begin = 0; begin < devices_.size(); begin += BATCH_SIZE) {
+		run_batch(begin, std::min(begin + BATCH_SIZE, devices_.size()));
+	}
+
+	std::vector<int> status;
+
+	status.reserve(devices_.size());
+	for (auto& device : devices_) {
+		status.push_back(device.status);
+	}
+
+	devices_.clear();
+	return status;
+}
+
+void LinuxHIDUring::run_batch(size_t begin, size_t end) {
+	probe_batch(begin, end);
+	open_batch(begin, end);
+
+	for (size_t i = begin; i < end; i++) {
+		auto &device = devices_[i];
+
+		if (!device.device) {
+			/*
+			 * Devices that aren't allowed are rejected without opening
+			 * them, otherwise open the device again so that the error is
+			 * reported normally
+			 */
+			device.device = std::make_unique<LinuxHIDDevice>(device.pathname,
+				std::move(device.sysfs_fd), unique_fd{});
+		}
+
+		HID_TRY {
+			Rejection rejection = device.device->prepare_identify();
+
+			if (rejection != Rejection::NONE) {
+				device.status = rejection_exit_status(rejection);
+				device.device.reset();
+			}
+		} HID_CATCH(const Exception&) {
+			device.status = exception_exit_status();
+			device.device.reset();
+		}
+	}
+
+	write_batch(begin, end);
+
+	for (size_t i = begin; i < end; i++) {
+		devices_[i].device.reset();
+	}
+}
+
+void LinuxHIDUring::probe_batch(size_t begin, size_t end) {
+	for (size_t i = begin; i < end; i++) {
+		auto &device = devices_[i];
+		struct stat st{};
+
+		if (::stat(device.pathname.c_str(), &st) < 0 || !S_ISCHR(st.st_mode)) {
+			continue;
+		}
+
+		device.sysfs_fd = HIDRawSysfs::instance().open_device(st.st_rdev);
+		if (!device.sysfs_fd) {
+			continue;
+		}
+
+		USBDeviceInfo device_info;
+		std::array<char, HID_PHYS_SIZE> phys;
+
+		if (HIDRawSysfs::device_info(device.sysfs_fd.get(), device_info, phys)) {
+			device.open = HIDDevice::device_allowed(device_info);
+		}
+	}
+}
+
+void LinuxHIDUring::open_batch(size_t begin, size_t end) {
+	unsigned int count = 0;
+
+	for (size_t i = begin; i < end; i++) {
+		if (!devices_[i].open) {
+			continue;
+		}
+
+		struct io_uring_sqe *sqe = ::io_uring_get_sqe(&ring_);
+
+		::io_uring_prep_openat(sqe, AT_FDCWD, devices_[i].pathname.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC, 0);
+		::io_uring_sqe_set_data64(sqe, i);
+		count++;
+	}
+
+	if (count > 0) {
+		wait(count, &LinuxHIDUring::opened);
+	}
+}
+
+void LinuxHIDUring::opened(Device &device, int res) {
+	if (res >= 0) {
+		device.device = std::make_unique<LinuxHIDDevice>(device.pathname,
+			std::move(device.sysfs_fd), unique_fd(res));
+	}
+}
+
+void LinuxHIDUring::write_batch(size_t begin, size_t end) {
+	struct __kernel_timespec timeout{};
+	unsigned int count = 0;
+
+	timeout.tv_sec = LinuxHIDDevice::WRITE_TIMEOUT.count() / 1000;
+	timeout.tv_nsec = (LinuxHIDDevice::WRITE_TIMEOUT.count() % 1000) * 1000000;
+
+	for (size_t i = begin; i < end; i++) {
+		auto &device = devices_[i];
+
+		if (!device.device) {
+			continue;
+		}
+
+		struct io_uring_sqe *sqe = ::io_uring_get_sqe(&ring_);
+
+		::io_uring_prep_write(sqe, device.device->fd(), device.device->report(),
+			device.device->report_length(), 0);
+		::io_uring_sqe_set_data64(sqe, i);
+		::io_uring_sqe_set_flags(sqe, IOSQE_IO_LINK);
+
+		sqe = ::io_uring_get_sqe(&ring_);
+		::io_uring_prep_link_timeout(sqe, &timeout, 0);
+		::io_uring_sqe_set_data64(sqe, LINK_TIMEOUT_DATA);
+
+		count += 2;
+	}
+
+	if (count > 0) {
+		wait(count, &LinuxHIDUring::written);
+	}
+}
+
+void LinuxHIDUring::written(Device &device, int res) {
+	HID_TRY {
+		device.device->report_written(res);
+	} HID_CATCH(const Exception&) {
+		device.status = exception_exit_status();
+	}
+}
+
+void LinuxHIDUring::wait(unsigned int count, void (LinuxHIDUring::*func)(Device &device, int res)) {
+	int ret = ::io_uring_submit_and_wait(&ring_, count);
+	if (ret < 0) {
+		errno = -ret;
+		log(LogLevel::ERROR, LogCategory::OS_ERROR, LogMessage::DEV_OS_FUNC_ERROR_CODE_1,
+			LOG_FORMAT("%s: %s"), "io_uring_submit_and_wait", get_strerror().c_str());
+		throw_error(OSError{});
+	}
+
+	while (count > 0) {
+		struct io_uring_cqe *cqe = nullptr;
+
+		ret = ::io_uring_wait_cqe(&ring_, &cqe);
+		if (ret < 0) {
+			if (ret == -EINTR) {
+				continue;
+			}
+
+			errno = -ret;
+			log(LogLevel::ERROR, LogCategory::OS_ERROR, LogMessage::DEV_OS_FUNC_ERROR_CODE_1,
+				LOG_FORMAT("%s: %s"), "io_uring_wait_cqe", get_strerror().c_str());
+			throw_error(OSError{});
+		}
+
+		uint64_t data = ::io_uring_cqe_get_data64(cqe);
+		int res = cqe->res;
+
+		::io_uring_cqe_seen(&ring_, cqe);
+		count--;
+
+		if (data != LINK_TIMEOUT_DATA) {
+			(this->*func)(devices_[data], res);
+		}
+	}
+}
+
+void LinuxHIDUring::log_message(LogLevel level, LogCategory category,
+		LogMessage message, const char *format, const LogArg *args,
+		size_t count) noexcept {
+	vlog(level, category, message, nullptr, format, args, count);
+}
+
+} // namespace hid_identify
@@ -0,0 +1,96 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <liburing.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../common/log-filter.h"
+#include "../common/log-format.h"
+#include "../common/types.h"
+#include "hid-identify.h"
+#include "unique-fd.h"
+
+namespace hid_identify {
+
+/*
+ * Identify multiple devices using io_uring to submit the open and write
+ * system calls for batches of devices at the same time. Devices that aren't
+ * allowed based on their information in sysfs are not opened.
+ *
+ * If io_uring is not available then the object will evaluate to false and
+ * another method must be used instead.
+ */
+class LinuxHIDUring {
+public:
+	LinuxHIDUring();
+	~LinuxHIDUring();
+
+	explicit operator bool() const { return initialised_; }
+
+	void add(const std::string &pathname);
+
+	/*
+	 * Returns the completion status of each device in the order they were
+	 * added, using the exit status values from sysexits.h.
+	 */
+	std::vector<int> run();
+
+	LinuxHIDUring(const LinuxHIDUring&) = delete;
+	LinuxHIDUring& operator=(const LinuxHIDUring&) = delete;
+
+private:
+	struct Device {
+		std::string pathname;
+		std::unique_ptr<LinuxHIDDevice> device;
+		int status;
+		/* Device directory in sysfs, if it could be found */
+		unique_fd sysfs_fd;
+		/* Device information from sysfs allows the device to be opened */
+		bool open;
+	};
+
+	void run_batch(size_t begin, size_t end);
+	void probe_batch(size_t begin, size_t end);
+	void open_batch(size_t begin, size_t end);
+	void write_batch(size_t begin, size_t end);
+	void wait(unsigned int count, void (LinuxHIDUring::*func)(Device &device, int res));
+	void opened(Device &device, int res);
+	void written(Device &device, int res);
+
+	template <class Format, class... Args>
+	void log(LogLevel level, LogCategory category, LogMessage message,
+			Format format, const Args&... args) noexcept {
+		if (log_enabled(level, category)) {
+			LogArgs values{format, args...};
+			log_message(level, category, message, values.format(message), values.data(), values.size());
+		}
+	}
+
+	void log_message(LogLevel level, LogCategory category, LogMessage message,
+		const char *format, const LogArg *args, size_t count) noexcept;
+
+	struct io_uring ring_{};
+	bool initialised_ = false;
+	std::vector<Device> devices_;
+};
+
+} // namespace hid_identify
@@ -0,0 +1,103 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "hid-workers.h"
+
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../common/types.h"
+#include "exit-status.h"
+#include "hid-identify.h"
+
+namespace hid_identify {
+
+LinuxHIDWorkers::LinuxHIDWorkers(unsigned int jobs) : jobs_(std::max(jobs, 1U)) {
+}
+
+void LinuxHIDWorkers::add(const std::string &pathname) {
+	devices_.push_back(std::make_unique<LinuxHIDDevice>(pathname));
+}
+
+void LinuxHIDWorkers::add(HIDRawSysfsDevice &&device) {
+	devices_.push_back(std::make_unique<LinuxHIDDevice>(std::move(device)));
+}
+
+std::vector<int> LinuxHIDWorkers::run() {
+	std::vector<std::thread> threads;
+	size_t count = std::min(static_cast<size_t>(jobs_), devices_.size());
+
+	status_.assign(devices_.size(), 0);
+	next_ = 0;
+
+	threads.reserve(count);
+	HID_TRY {
+		for (size_t i = 0; i < count; i++) {
+			threads.emplace_back(&LinuxHIDWorkers::worker, this);
+		}
+	} HID_CATCH(...) {
+		/* Stop the other threads from starting any more devices */
+		next_ = devices_.size();
+
+		for (auto& thread : threads) {
+			thread.join();
+		}
+		HID_RETHROW;
+	}
+
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	if (error_) {
+		std::rethrow_exception(error_);
+	}
+
+	devices_.clear();
+	return std::move(status_);
+}
+
+void LinuxHIDWorkers::worker() noexcept {
+	size_t i;
+
+	while ((i = next_++) < devices_.size()) {
+		/* Close each device as soon as it has been identified */
+		std::unique_ptr<LinuxHIDDevice> device = std::move(devices_[i]);
+
+		HID_TRY {
+			status_[i] = rejection_exit_status(device->identify());
+		} HID_CATCH(const Exception&) {
+			status_[i] = exception_exit_status();
+		} HID_CATCH(...) {
+			std::lock_guard<std::mutex> lock{error_mutex_};
+
+			if (!error_) {
+				error_ = std::current_exception();
+			}
+
+			status_[i] = exception_exit_status();
+		}
+	}
+}
+
+} // namespace hid_identify
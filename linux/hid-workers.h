@@ -0,0 +1,60 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "hid-identify.h"
+#include "sysfs.h"
+
+namespace hid_identify {
+
+/*
+ * Identify multiple devices in parallel using a bounded number of threads.
+ */
+class LinuxHIDWorkers {
+public:
+	explicit LinuxHIDWorkers(unsigned int jobs);
+
+	void add(const std::string &pathname);
+	void add(HIDRawSysfsDevice &&device);
+
+	/*
+	 * Returns the completion status of each device in the order they were
+	 * added, using the exit status values from sysexits.h.
+	 */
+	std::vector<int> run();
+
+private:
+	void worker() noexcept;
+
+	const unsigned int jobs_;
+	std::vector<std::unique_ptr<LinuxHIDDevice>> devices_;
+	std::vector<int> status_;
+	std::atomic<size_t> next_{0};
+
+	std::mutex error_mutex_;
+	std::exception_ptr error_;
+};
+
+} // namespace hid_identify
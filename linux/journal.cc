@@ -0,0 +1,215 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "journal.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "unique-fd.h"
+
+namespace hid_identify {
+
+JournalSocket::JournalSocket(const char *path) noexcept {
+	struct sockaddr_un addr{};
+
+	if (std::strlen(path) >= sizeof(addr.sun_path)) {
+		return;
+	}
+
+	addr.sun_family = AF_UNIX;
+	std::strcpy(addr.sun_path, path);
+
+	fd_ = unique_fd{::socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0)};
+	if (!fd_) {
+		return;
+	}
+
+	if (::connect(fd_.get(), reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr))) {
+		fd_.clear();
+	}
+}
+
+bool JournalSocket::stderr_is_journal() noexcept {
+	const char *stream = std::getenv("JOURNAL_STREAM");
+	unsigned long long dev, ino;
+	struct stat st;
+
+	if (stream == nullptr || std::sscanf(stream, "%llu:%llu", &dev, &ino) != 2) {
+		return false;
+	}
+
+	if (::fstat(STDERR_FILENO, &st)) {
+		return false;
+	}
+
+	return st.st_dev == dev && st.st_ino == ino;
+}
+
+bool JournalSocket::send(const struct iovec *iov, size_t count) noexcept {
+	struct msghdr msg{};
+
+	msg.msg_iov = const_cast<struct iovec*>(iov);
+	msg.msg_iovlen = count;
+
+	if (::sendmsg(fd_.get(), &msg, MSG_NOSIGNAL) >= 0) {
+		return true;
+	}
+
+	if (errno == EMSGSIZE || errno == ENOBUFS) {
+		return send_memfd(iov, count);
+	}
+
+	return false;
+}
+
+bool JournalSocket::send_memfd(const struct iovec *iov, size_t count) noexcept {
+	unique_fd memfd{::memfd_create("journal-message", MFD_CLOEXEC | MFD_ALLOW_SEALING)};
+
+	if (!memfd) {
+		return false;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		auto data = static_cast<const char*>(iov[i].iov_base);
+		size_t length = iov[i].iov_len;
+
+		while (length > 0) {
+			ssize_t ret = ::write(memfd.get(), data, length);
+
+			if (ret < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+
+				return false;
+			}
+
+			data += ret;
+			length -= ret;
+		}
+	}
+
+	/* The journal only accepts a memfd that can't be modified */
+	if (::fcntl(memfd.get(), F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL)) {
+		return false;
+	}
+
+	union {
+		struct cmsghdr align;
+		std::array<char, CMSG_SPACE(sizeof(int))> buf;
+	} control{};
+	struct msghdr msg{};
+
+	msg.msg_control = control.buf.data();
+	msg.msg_controllen = control.buf.size();
+
+	struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+	int fd = memfd.get();
+
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	std::memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+	return ::sendmsg(fd_.get(), &msg, MSG_NOSIGNAL) >= 0;
+}
+
+/* Write the name of a field and the separator or length of its value */
+static size_t field_header(char *buf, size_t length, const char *name, size_t name_length,
+		bool binary, size_t value_length) noexcept {
+	std::memcpy(&buf[length], name, name_length);
+	length += name_length;
+
+	if (binary) {
+		buf[length++] = '\n';
+
+		for (size_t i = 0; i < sizeof(uint64_t); i++) {
+			buf[length++] = static_cast<char>((static_cast<uint64_t>(value_length) >> (i * 8)) & 0xFF);
+		}
+	} else {
+		buf[length++] = '=';
+	}
+
+	return length;
+}
+
+size_t journal_field(char *buf, size_t size, size_t length,
+		const char *name, const char *value, size_t value_length) noexcept {
+	size_t name_length = std::strlen(name);
+	bool binary = std::memchr(value, '\n', value_length) != nullptr;
+	size_t header_length = name_length + 1 + (binary ? sizeof(uint64_t) : 0);
+
+	if (length + header_length + 1 > size) {
+		return length;
+	}
+
+	/* Truncate the value if it doesn't fit */
+	value_length = std::min(value_length, size - length - header_length - 1);
+
+	length = field_header(buf, length, name, name_length, binary, value_length);
+	std::memcpy(&buf[length], value, value_length);
+	length += value_length;
+	buf[length++] = '\n';
+	return length;
+}
+
+size_t journal_field_name(char *buf, size_t size, size_t length,
+		const char *name, const char *value, size_t value_length) noexcept {
+	size_t name_length = std::strlen(name);
+	bool binary = std::memchr(value, '\n', value_length) != nullptr;
+	size_t header_length = name_length + 1 + (binary ? sizeof(uint64_t) : 0);
+
+	if (length + header_length > size) {
+		return length;
+	}
+
+	return field_header(buf, length, name, name_length, binary, value_length);
+}
+
+size_t journal_fieldf(char *buf, size_t size, size_t length,
+		const char *name, const char *format...) noexcept {
+	std::array<char, 256> value;
+	std::va_list args;
+
+	va_start(args, format);
+	int ret = std::vsnprintf(value.data(), value.size(), format, args);
+	va_end(args);
+
+	if (ret < 0) {
+		return length;
+	}
+
+	return journal_field(buf, size, length, name, value.data(),
+		std::min(static_cast<size_t>(ret), value.size() - 1));
+}
+
+} // namespace hid_identify
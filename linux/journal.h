@@ -0,0 +1,75 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <sys/uio.h>
+
+#include <cstddef>
+
+#include "unique-fd.h"
+
+namespace hid_identify {
+
+/*
+ * Send structured messages to the systemd journal using its native protocol,
+ * where each datagram contains a list of fields:
+ *
+ *   KEY=value\n
+ *   KEY\n<64-bit little-endian length>value\n
+ *
+ * Messages that are too large for a datagram are written to a sealed memfd
+ * and the file descriptor is sent instead.
+ */
+class JournalSocket {
+public:
+	static constexpr const char *DEFAULT_PATH = "/run/systemd/journal/socket";
+
+	explicit JournalSocket(const char *path = DEFAULT_PATH) noexcept;
+
+	explicit operator bool() const { return fd_ ? true : false; }
+
+	/* Check if the standard error stream is connected to the journal */
+	static bool stderr_is_journal() noexcept;
+
+	/* Send one message made up of the fields in the buffers */
+	bool send(const struct iovec *iov, size_t count) noexcept;
+
+private:
+	bool send_memfd(const struct iovec *iov, size_t count) noexcept;
+
+	unique_fd fd_;
+};
+
+/* Append a field to a buffer, returning the length of the buffer */
+size_t journal_field(char *buf, size_t size, size_t length,
+	const char *name, const char *value, size_t value_length) noexcept;
+
+/*
+ * Append only the name (and length) of a field to a buffer, for a value that
+ * is sent from another buffer followed by a newline, returning the length of
+ * the buffer (which is unchanged if it doesn't fit)
+ */
+size_t journal_field_name(char *buf, size_t size, size_t length,
+	const char *name, const char *value, size_t value_length) noexcept;
+
+/* Append a field with a formatted value to a buffer */
+size_t journal_fieldf(char *buf, size_t size, size_t length,
+	const char *name, const char *format...) noexcept
+	__attribute__((format(printf, 5, 6)));
+
+} // namespace hid_identify
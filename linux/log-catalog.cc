@@ -0,0 +1,70 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "logging.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+
+#include "log-catalog-table.h"
+
+namespace hid_identify {
+
+/* There are no translations when all of the hashes are 0 */
+static constexpr std::array<LogTranslation, LogCatalog::MESSAGES> UNTRANSLATED{};
+
+const LogTranslation *log_translations = UNTRANSLATED.data();
+
+static bool find_language(const char *language, size_t length) noexcept {
+	for (size_t i = 0; i < LogCatalog::LANGUAGES.size(); i++) {
+		if (std::strlen(LogCatalog::LANGUAGES[i]) == length
+				&& !std::strncmp(LogCatalog::LANGUAGES[i], language, length)) {
+			log_translations = LogCatalog::TRANSLATIONS[i].data();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool set_log_language(const char *locale) noexcept {
+	log_translations = UNTRANSLATED.data();
+
+	if (locale == nullptr) {
+		return false;
+	}
+
+	/* Try the language and territory (e.g. "pt_BR") and then only the language */
+	return find_language(locale, std::strcspn(locale, ".@"))
+		|| find_language(locale, std::strcspn(locale, "_.@"));
+}
+
+void select_log_language() noexcept {
+	for (const char *name : {"LC_ALL", "LC_MESSAGES", "LANG"}) {
+		const char *value = std::getenv(name);
+
+		if (value != nullptr && value[0]) {
+			set_log_language(value);
+			return;
+		}
+	}
+}
+
+} // namespace hid_identify
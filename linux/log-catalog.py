@@ -0,0 +1,192 @@
+#!/usr/bin/env python3
+#
+#	qmk-hid-identify - Identify the current OS to QMK device
+#	Copyright 2026  Simon Arlott
+#
+#	This program is free software: you can redistribute it and/or modify
+#	it under the terms of the GNU General Public License as published by
+#	the Free Software Foundation, either version 3 of the License, or
+#	(at your option) any later version.
+#
+#	This program is distributed in the hope that it will be useful,
+#	but WITHOUT ANY WARRANTY; without even the implied warranty of
+#	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#	GNU General Public License for more details.
+#
+#	You should have received a copy of the GNU General Public License
+#	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#
+#
+# Generate a table of log message translations for each language, indexed by
+# LogMessage, from the LogMessage values in types.h, the source files that log
+# them and a "<language>.po" file for each language.
+#
+# Each message must always be logged with the same format so that it can be
+# looked up by its LogMessage value. The hash of the format is included with
+# each translation so that it's only used for that format.
+#
+# The hash function must match log_format_hash() in log-format.h.
+#
+# Usage: log-catalog.py --types <types.h> <output> <source or .po file>...
+
+import argparse
+import os
+import re
+import sys
+
+MESSAGE_RE = re.compile(r"LOGGING_MESSAGE\((\w+)\)")
+LOG_RE = re.compile(r'LogMessage::(\w+),\s*LOG_FORMAT\("((?:[^"\\]|\\.)*)"\)')
+ESCAPES = {"n": "\n", "t": "\t", "\\": "\\", '"': '"'}
+
+
+def unescape(text):
+	return re.sub(r"\\(.)", lambda match: ESCAPES.get(match.group(1), match.group(1)), text)
+
+
+def escape(text):
+	return '"' + text.replace("\\", "\\\\").replace('"', '\\"').replace("\n", "\\n").replace("\t", "\\t") + '"'
+
+
+def format_hash(text):
+	value = 0x811C9DC5
+	for byte in text.encode("utf-8"):
+		value = ((value ^ byte) * 0x01000193) & 0xFFFFFFFF
+	return value or 1
+
+
+def format_arguments(text):
+	return re.findall(r"%.", text)
+
+
+def parse_messages(filename):
+	with open(filename, "r") as f:
+		text = f.read()
+
+	start = text.index("enum class LogMessage")
+	return MESSAGE_RE.findall(text[start:text.index("};", start)])
+
+
+def parse_sources(filenames, messages):
+	formats = {}
+
+	for filename in filenames:
+		with open(filename, "r") as f:
+			for message, text in LOG_RE.findall(f.read()):
+				text = unescape(text)
+
+				if message not in messages:
+					sys.exit(f"{filename}: Unknown message {message}")
+				if formats.setdefault(message, text) != text:
+					sys.exit(f"{filename}: Message {message} logged with different formats")
+
+	return formats
+
+
+def parse_po(filename):
+	translations = {}
+	entry = {}
+	field = None
+
+	def finish():
+		if "msgid" in entry and "msgstr" in entry and entry["msgstr"] \
+				and "fuzzy" not in entry.get("flags", "") and "msgctxt" not in entry:
+			translations[entry["msgid"]] = entry["msgstr"]
+		entry.clear()
+
+	with open(filename, "r", encoding="utf-8") as f:
+		for number, line in enumerate(f, 1):
+			line = line.strip()
+
+			if not line:
+				finish()
+				field = None
+			elif line.startswith("#,"):
+				finish()
+				entry["flags"] = line[2:]
+			elif line.startswith("#"):
+				continue
+			elif line.startswith('"') and field is not None:
+				entry[field] += unescape(line[1:-1])
+			else:
+				match = re.fullmatch(r'(msgctxt|msgid|msgid_plural|msgstr(?:\[\d+\])?)\s+"(.*)"', line)
+				if not match:
+					sys.exit(f"{filename}:{number}: Invalid line")
+
+				field = match.group(1)
+				if field == "msgctxt" or (field == "msgid" and "msgid" in entry):
+					finish()
+				entry[field] = unescape(match.group(2))
+
+	finish()
+	return translations
+
+
+def main():
+	parser = argparse.ArgumentParser(description="Generate a table of log message translations")
+	parser.add_argument("--types", required=True, help="types.h with the LogMessage values")
+	parser.add_argument("output")
+	parser.add_argument("inputs", nargs="+", help="source files and .po files")
+	args = parser.parse_args()
+
+	messages = parse_messages(args.types)
+	formats = parse_sources([name for name in args.inputs if not name.endswith(".po")], set(messages))
+	languages = []
+
+	for filename in sorted(name for name in args.inputs if name.endswith(".po")):
+		translations = parse_po(filename)
+		table = []
+
+		for message in messages:
+			text = formats.get(message)
+			translation = translations.get(text) if text is not None else None
+
+			if translation is not None and format_arguments(translation) != format_arguments(text):
+				sys.exit(f"{filename}: Translation of \"{text}\" has different arguments")
+
+			table.append((message, text, translation))
+
+		languages.append((os.path.basename(filename)[:-3], table))
+
+	lines = [
+		f"/* Generated by log-catalog.py from {os.path.basename(args.types)}, do not edit */",
+		"#pragma once",
+		"",
+		"/* Include logging.h first */",
+		"#include <array>",
+		"#include <cstddef>",
+		"",
+		"namespace hid_identify {",
+		"",
+		"struct LogCatalog {",
+		f"\tstatic constexpr size_t MESSAGES = {len(messages)};",
+		"",
+		f"\tstatic constexpr std::array<const char*, {len(languages)}> LANGUAGES{{{{",
+	]
+	lines += [f"\t\t{escape(language)}," for (language, _) in languages]
+	lines += [
+		"\t}};",
+		"",
+		f"\tstatic constexpr std::array<std::array<LogTranslation, MESSAGES>, {len(languages)}> TRANSLATIONS{{{{",
+	]
+	for (language, table) in languages:
+		lines.append(f"\t\t/* {language} */ {{{{")
+		for (message, text, translation) in table:
+			if translation is None:
+				lines.append(f"\t\t\t{{ 0, nullptr }}, /* {message} */")
+			else:
+				lines.append(f"\t\t\t{{ 0x{format_hash(text):08X}, {escape(translation)} }}, /* {message} */")
+		lines.append("\t\t}},")
+	lines += [
+		"\t}};",
+		"};",
+		"",
+		"} // namespace hid_identify",
+		"",
+	]
+
+	with open(args.output, "w") as f:
+		f.write("\n".join(lines))
+
+
+if __name__ == "__main__":
+	main()
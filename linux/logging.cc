@@ -0,0 +1,695 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "logging.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <syslog.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../common/log-filter.h"
+#include "../common/log-format.h"
+#include "../common/types.h"
+#include "journal.h"
+#include "log-catalog-table.h"
+
+namespace hid_identify {
+
+/* Maximum length of a message, excluding the device */
+static constexpr size_t TEXT_SIZE = 256;
+
+/* Maximum length of a device pathname or name (the same as HID_PHYS_SIZE) */
+static constexpr size_t DEVICE_SIZE = 256;
+
+/* Maximum length of a message including the device */
+static constexpr size_t LINE_SIZE = TEXT_SIZE + DEVICE_SIZE * 2 + 5;
+
+/* Maximum number of messages waiting to be written (must be a power of 2) */
+static constexpr size_t RECORDS = 256;
+
+/* Size of the console output buffer for each batch of messages */
+static constexpr size_t BATCH_SIZE = 16384;
+
+/* Size of the journal fields for each message, other than the text of the message */
+static constexpr size_t JOURNAL_SIZE = 2048;
+
+/*
+ * Journal message IDs are this prefix followed by the permanent number of the
+ * message (as 4 hexadecimal digits), so that messages can be found without
+ * parsing them.
+ */
+static constexpr const char *MESSAGE_ID_PREFIX = "231bd15e1d634d4aa177399503f4";
+
+/*
+ * Permanent number of every message, which must never be changed or reused
+ * for a different message. Every message has the same number as its
+ * MessageId in windows/events.mc.
+ */
+static constexpr std::array<std::pair<LogMessage, uint16_t>, LogCatalog::MESSAGES> MESSAGE_NUMBERS{{
+	{LogMessage::DEV_REPORT_SENT, 0x0100},
+	{LogMessage::DEV_REPORT_SENT_LATENCY, 0x0101},
+
+	{LogMessage::DEV_NOT_ALLOWED, 0x0110},
+	{LogMessage::DEV_UNKNOWN_USAGE, 0x0111},
+	{LogMessage::DEV_UNKNOWN_USB_INTERFACE_NUMBER, 0x0112},
+	{LogMessage::DEV_NO_HID_ATTRIBUTES, 0x0113},
+	{LogMessage::DEV_ACCESS_DENIED, 0x0114},
+	{LogMessage::DEV_TOO_MANY_REPORTS, 0x0115},
+
+	{LogMessage::DEV_REPORT_COUNT_TOO_SMALL, 0x0120},
+	{LogMessage::DEV_REPORT_LENGTH_TOO_SMALL, 0x0121},
+	{LogMessage::DEV_REPORT_COUNT_TOO_LARGE, 0x0122},
+
+	{LogMessage::DEV_WRITE_FAILED, 0x0130},
+	{LogMessage::DEV_WRITE_TIMEOUT, 0x0131},
+	{LogMessage::DEV_SHORT_WRITE, 0x0132},
+
+	{LogMessage::DEV_REPORT_DESCRIPTOR_SIZE_NEGATIVE, 0x0140},
+	{LogMessage::DEV_REPORT_DESCRIPTOR_SIZE_TOO_LARGE, 0x0141},
+	{LogMessage::DEV_MALFORMED_REPORT_DESCRIPTOR, 0x0142},
+
+	{LogMessage::DEV_OS_FUNC_ERROR_CODE_1, 0x1000},
+	{LogMessage::DEV_OS_FUNC_ERROR_CODE_2, 0x1001},
+	{LogMessage::DEV_OS_FUNC_ERROR_PARAM_1_CODE_1, 0x1002},
+
+	{LogMessage::SVC_STARTING, 0x0200},
+	{LogMessage::SVC_STARTED, 0x0201},
+	{LogMessage::SVC_STOPPING, 0x0202},
+	{LogMessage::SVC_STOPPED, 0x0203},
+	{LogMessage::SVC_FAILED, 0x0204},
+
+	{LogMessage::SVC_MAIN_MUTEX_FAILURE, 0x0210},
+	{LogMessage::SVC_CTRL_MUTEX_FAILURE, 0x0211},
+
+	{LogMessage::SVC_POWER_RESUME, 0x0300},
+
+	{LogMessage::SVC_UEVENT_OVERFLOW, 0x0310},
+	{LogMessage::SVC_DEVICE_OVERRIDES_INVALID, 0x0312},
+
+	{LogMessage::SVC_OS_FUNC_ERROR_CODE_1, 0x2000},
+	{LogMessage::SVC_OS_FUNC_ERROR_CODE_2, 0x2001},
+
+	{LogMessage::SVC_LOG_SUPPRESSED, 0x0320},
+	{LogMessage::SVC_LOG_DROPPED, 0x0321},
+}};
+
+/* Every message must be listed once, with a different non-zero number */
+static constexpr bool valid_message_numbers() {
+	for (size_t i = 0; i < MESSAGE_NUMBERS.size(); i++) {
+		if (static_cast<size_t>(MESSAGE_NUMBERS[i].first) >= LogCatalog::MESSAGES
+				|| MESSAGE_NUMBERS[i].second == 0) {
+			return false;
+		}
+
+		for (size_t j = 0; j < i; j++) {
+			if (MESSAGE_NUMBERS[i].first == MESSAGE_NUMBERS[j].first
+					|| MESSAGE_NUMBERS[i].second == MESSAGE_NUMBERS[j].second) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+static_assert(valid_message_numbers(), "Log message numbers must be unique");
+
+/* Permanent number of each message, indexed by LogMessage */
+static constexpr std::array<uint16_t, LogCatalog::MESSAGES> message_number_table() {
+	std::array<uint16_t, LogCatalog::MESSAGES> numbers{};
+
+	for (const auto& entry : MESSAGE_NUMBERS) {
+		numbers[static_cast<size_t>(entry.first)] = entry.second;
+	}
+
+	return numbers;
+}
+
+static constexpr std::array<uint16_t, LogCatalog::MESSAGES> MESSAGE_ID_NUMBERS = message_number_table();
+
+static const std::array<const char*, 5> CATEGORY_NAMES{
+	"REPORT_SENT",
+	"OS_ERROR",
+	"IO_ERROR",
+	"UNSUPPORTED_DEVICE",
+	"SERVICE",
+};
+
+namespace {
+
+struct LogRecord {
+	/* Set by the producer when the record is complete, cleared by the writer */
+	std::atomic<bool> ready;
+	LogLevel level;
+	LogCategory category;
+	LogMessage message;
+	bool has_info;
+	USBDeviceInfo info;
+	std::array<char, DEVICE_SIZE> device;
+	std::array<char, DEVICE_SIZE> name;
+	std::array<char, TEXT_SIZE> text;
+};
+
+enum class WriterState {
+	NONE,
+	RUNNING,
+	FAILED,
+	STOPPED,
+};
+
+/* Console output for a batch of messages, written directly to the file descriptor */
+class LogBatch {
+public:
+	explicit LogBatch(int fd) : fd_(fd) {}
+	~LogBatch() { flush(); }
+
+	void append(const char *line, size_t length) noexcept {
+		if (length_ + length + 1 > buf_.size()) {
+			flush();
+		}
+
+		length = std::min(length, buf_.size() - 1);
+		std::copy(line, line + length, &buf_[length_]);
+		length_ += length;
+		buf_[length_++] = '\n';
+	}
+
+	void flush() noexcept {
+		size_t pos = 0;
+
+		while (pos < length_) {
+			ssize_t ret = ::write(fd_, &buf_[pos], length_ - pos);
+
+			if (ret < 0 && errno == EINTR) {
+				continue;
+			} else if (ret <= 0) {
+				break;
+			}
+
+			pos += ret;
+		}
+
+		length_ = 0;
+	}
+
+private:
+	int fd_;
+	std::array<char, BATCH_SIZE> buf_;
+	size_t length_ = 0;
+};
+
+} // namespace
+
+/*
+ * When there are multiple threads identifying devices, messages are
+ * formatted by the calling thread into a fixed size ring buffer of records
+ * and then written to syslog and the console (or the journal) in batches by a
+ * background thread, so that logging doesn't block on I/O. Otherwise they're
+ * written immediately, which avoids starting a thread for one device.
+ *
+ * Producers claim a record by incrementing write_pos and the writer releases
+ * it by incrementing read_pos after it has been written. If the ring buffer
+ * is full the message is dropped and counted instead of waiting.
+ *
+ * Everything here is zero-initialised so there's nothing to do at startup
+ * unless a message is logged.
+ */
+static std::array<LogRecord, RECORDS> records;
+static std::atomic<size_t> write_pos;
+static std::atomic<size_t> read_pos;
+static std::atomic<unsigned long> dropped;
+static std::atomic<unsigned long> total_written;
+static std::atomic<unsigned long> total_dropped;
+
+static std::once_flag writer_once;
+static bool writer_enabled;
+static std::thread writer_thread;
+static std::atomic<WriterState> writer_state;
+
+/* Protects waiting/stopping and serialises synchronous console output */
+static std::mutex writer_mutex;
+static std::condition_variable writer_cv;
+static std::condition_variable flushed_cv;
+static std::atomic<bool> writer_waiting;
+static bool writer_stopping;
+
+static const char *journal_path;
+static std::optional<JournalSocket> journal;
+
+/* POSIX */
+static inline __attribute__((unused)) const char *call_strerror_r(
+		std::vector<char> &buf, int (*func)(int, char *, size_t)) {
+	if (func(errno, buf.data(), buf.size()) == 0) {
+		return buf.data();
+	} else {
+		return nullptr;
+	}
+}
+
+/* GNU */
+static inline __attribute__((unused)) const char *call_strerror_r(
+		std::vector<char> &buf, char *(*func)(int, char *, size_t)) {
+	return func(errno, buf.data(), buf.size());
+}
+
+std::string get_strerror() {
+	std::vector<char> buf(1024);
+
+	auto ret = call_strerror_r(buf, ::strerror_r);
+	if (ret != nullptr) {
+		return ret;
+	} else {
+		return std::to_string(errno);
+	}
+}
+
+static void copy_string(std::array<char, DEVICE_SIZE> &dst, const char *src) noexcept {
+	if (src != nullptr) {
+		std::snprintf(dst.data(), dst.size(), "%s", src);
+	} else {
+		dst[0] = '\0';
+	}
+}
+
+static void format_record(LogRecord &record, LogLevel level, LogCategory category,
+		LogMessage message, const LogDevice *device, const char *format,
+		const LogArg *args, size_t count) noexcept {
+	record.level = level;
+	record.category = category;
+	record.message = message;
+
+	if (device != nullptr) {
+		copy_string(record.device, device->pathname);
+		copy_string(record.name, device->name);
+		record.has_info = device->info != nullptr;
+		if (record.has_info) {
+			record.info = *device->info;
+		}
+	} else {
+		record.device[0] = '\0';
+		record.name[0] = '\0';
+		record.has_info = false;
+	}
+
+	log_format(record.text.data(), record.text.size(), format, args, count);
+}
+
+/* Format a message about logging itself */
+template <class Format, class... Args>
+static void format_own_record(LogRecord &record, LogLevel level, LogCategory category,
+		LogMessage message, Format format, const Args&... args) noexcept {
+	LogArgs values{format, args...};
+
+	format_record(record, level, category, message, nullptr,
+		values.format(message), values.data(), values.size());
+}
+
+/* Format the whole message, including the device */
+static size_t format_line(const LogRecord &record, std::array<char, LINE_SIZE> &line) noexcept {
+	int length;
+
+	if (record.name[0]) {
+		length = std::snprintf(line.data(), line.size(), "%s (%s): %s",
+			record.device.data(), record.name.data(), record.text.data());
+	} else if (record.device[0]) {
+		length = std::snprintf(line.data(), line.size(), "%s: %s",
+			record.device.data(), record.text.data());
+	} else {
+		length = std::snprintf(line.data(), line.size(), "%s", record.text.data());
+	}
+
+	return std::clamp(length, 0, static_cast<int>(line.size() - 1));
+}
+
+static bool send_journal(const LogRecord &record, const char *line, size_t line_length) noexcept {
+	std::array<char, JOURNAL_SIZE> buf;
+	size_t length = 0;
+	auto category = static_cast<size_t>(record.category);
+
+	length = journal_fieldf(buf.data(), buf.size(), length, "PRIORITY", "%d",
+		static_cast<int>(record.level));
+	length = journal_fieldf(buf.data(), buf.size(), length, "SYSLOG_IDENTIFIER", "%s",
+		program_invocation_short_name);
+	length = journal_fieldf(buf.data(), buf.size(), length, "MESSAGE_ID", "%s%04x",
+		MESSAGE_ID_PREFIX, MESSAGE_ID_NUMBERS[static_cast<size_t>(record.message)]);
+
+	if (category < CATEGORY_NAMES.size()) {
+		length = journal_fieldf(buf.data(), buf.size(), length, "QMK_CATEGORY", "%s",
+			CATEGORY_NAMES[category]);
+	}
+
+	if (record.device[0]) {
+		length = journal_fieldf(buf.data(), buf.size(), length, "QMK_DEVICE", "%s",
+			record.device.data());
+	}
+
+	if (record.name[0]) {
+		length = journal_field(buf.data(), buf.size(), length, "QMK_DEVICE_NAME",
+			record.name.data(), std::strlen(record.name.data()));
+	}
+
+	if (record.has_info) {
+		length = journal_fieldf(buf.data(), buf.size(), length, "QMK_USB_VID", "%04x",
+			record.info.vendor);
+		length = journal_fieldf(buf.data(), buf.size(), length, "QMK_USB_PID", "%04x",
+			record.info.product);
+
+		if (record.info.interface_number >= 0) {
+			length = journal_fieldf(buf.data(), buf.size(), length, "QMK_USB_INTERFACE", "%d",
+				record.info.interface_number);
+		}
+	}
+
+	/*
+	 * The message is sent from the line buffer so that it's never truncated,
+	 * and as a memfd if the journal won't accept a datagram that large
+	 */
+	size_t header_length = journal_field_name(buf.data(), buf.size(), length,
+		"MESSAGE", line, line_length);
+	if (header_length == length) {
+		return false;
+	}
+
+	std::array<struct iovec, 3> iov{{
+		{buf.data(), header_length},
+		{const_cast<char*>(line), line_length},
+		{const_cast<char*>("\n"), 1},
+	}};
+
+	return journal->send(iov.data(), iov.size());
+}
+
+/* Write a message to the journal, or syslog and a batch of console output */
+static void write_record(const LogRecord &record, LogBatch &out, LogBatch &err) noexcept {
+	std::array<char, LINE_SIZE> line;
+	size_t length = format_line(record, line);
+
+	if (journal && send_journal(record, line.data(), length)) {
+		return;
+	}
+
+	::syslog(LOG_USER | static_cast<int>(record.level), "%s", line.data());
+
+	if (static_cast<int>(record.level) >= LOG_INFO) {
+		out.append(line.data(), length);
+	} else {
+		err.append(line.data(), length);
+	}
+}
+
+/*
+ * Log the number of messages suppressed by the rate limit in each category,
+ * once per interval (or immediately if this is the last time), returning
+ * true if there were any.
+ */
+static bool write_suppressed(LogBatch &out, LogBatch &err, bool last) noexcept {
+	static std::chrono::steady_clock::time_point last_report;
+	auto now = std::chrono::steady_clock::now();
+
+	if (!last && now - last_report < log_rate_limit_interval()) {
+		return false;
+	}
+
+	bool written = false;
+
+	last_report = now;
+	for (size_t i = 0; i < CATEGORY_NAMES.size(); i++) {
+		auto category = static_cast<LogCategory>(i);
+		unsigned long count = log_suppressed(category);
+
+		if (count > 0) {
+			LogRecord record;
+
+			format_own_record(record, LogLevel::WARNING, category, LogMessage::SVC_LOG_SUPPRESSED,
+				LOG_FORMAT("%s: %s messages suppressed"), CATEGORY_NAMES[i], count);
+			write_record(record, out, err);
+			written = true;
+		}
+	}
+
+	return written;
+}
+
+/* Write all messages that are ready, returning true if there were any */
+static bool write_records(LogBatch &out, LogBatch &err, bool last = false) noexcept {
+	size_t pos = read_pos.load(std::memory_order_relaxed);
+	size_t start = pos;
+
+	while (true) {
+		auto &record = records[pos % RECORDS];
+
+		if (!record.ready.load(std::memory_order_acquire)) {
+			break;
+		}
+
+		write_record(record, out, err);
+
+		record.ready.store(false, std::memory_order_relaxed);
+		read_pos.store(++pos, std::memory_order_release);
+	}
+
+	unsigned long count = dropped.exchange(0, std::memory_order_relaxed);
+	if (count > 0) {
+		LogRecord record;
+
+		format_own_record(record, LogLevel::WARNING, LogCategory::SERVICE, LogMessage::SVC_LOG_DROPPED,
+			LOG_FORMAT("%s log messages dropped"), count);
+		write_record(record, out, err);
+	}
+
+	bool suppressed = write_suppressed(out, err, last);
+
+	out.flush();
+	err.flush();
+
+	total_written.fetch_add(pos - start, std::memory_order_relaxed);
+	return pos != start || count > 0 || suppressed;
+}
+
+static bool records_ready() noexcept {
+	return records[read_pos.load(std::memory_order_relaxed) % RECORDS].ready.load(std::memory_order_seq_cst);
+}
+
+static void writer_main() noexcept {
+	LogBatch out{STDOUT_FILENO};
+	LogBatch err{STDERR_FILENO};
+
+	while (true) {
+		if (write_records(out, err)) {
+			std::lock_guard<std::mutex> lock{writer_mutex};
+			flushed_cv.notify_all();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock{writer_mutex};
+
+		if (writer_stopping) {
+			break;
+		}
+
+		/*
+		 * Producers check this after making a record ready, and then wake
+		 * the writer while holding the mutex so that it can't be missed.
+		 */
+		writer_waiting.store(true, std::memory_order_seq_cst);
+		if (!records_ready() && dropped.load(std::memory_order_relaxed) == 0) {
+			flushed_cv.notify_all();
+			auto interval = log_rate_limit_interval();
+
+			/* Wake up periodically to log the number of suppressed messages */
+			if (interval.count() > 0) {
+				writer_cv.wait_for(lock, interval);
+			} else {
+				writer_cv.wait(lock);
+			}
+		}
+		writer_waiting.store(false, std::memory_order_relaxed);
+	}
+
+	std::lock_guard<std::mutex> lock{writer_mutex};
+	flushed_cv.notify_all();
+}
+
+static void wake_writer() noexcept {
+	if (writer_waiting.load(std::memory_order_seq_cst)) {
+		std::lock_guard<std::mutex> lock{writer_mutex};
+		writer_cv.notify_one();
+	}
+}
+
+static void stop_writer() noexcept {
+	{
+		std::lock_guard<std::mutex> lock{writer_mutex};
+		writer_stopping = true;
+		writer_cv.notify_one();
+	}
+
+	writer_thread.join();
+	writer_state.store(WriterState::STOPPED, std::memory_order_release);
+
+	/* Messages may have been added after the writer checked for them */
+	LogBatch out{STDOUT_FILENO};
+	LogBatch err{STDERR_FILENO};
+
+	write_records(out, err, true);
+}
+
+/* Write a message immediately, or only the number of suppressed messages */
+static void write_now(const LogRecord *record, bool last) noexcept {
+	LogBatch out{STDOUT_FILENO};
+	LogBatch err{STDERR_FILENO};
+	std::lock_guard<std::mutex> lock{writer_mutex};
+
+	if (record != nullptr) {
+		write_record(*record, out, err);
+		total_written.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	write_suppressed(out, err, last);
+}
+
+static void stop_now() noexcept {
+	write_now(nullptr, true);
+}
+
+static bool start_writer() noexcept {
+	std::call_once(writer_once, [] {
+		if (journal_path != nullptr) {
+			journal.emplace(journal_path);
+		} else if (JournalSocket::stderr_is_journal()) {
+			journal.emplace();
+		}
+
+		if (journal && !*journal) {
+			journal.reset();
+		}
+
+		if (!writer_enabled) {
+			std::atexit(stop_now);
+			return;
+		}
+
+		/*
+		 * Signals must only be delivered to the threads that handle them
+		 * (the daemon uses a signalfd after blocking them in its thread),
+		 * so they're all blocked in the writer thread.
+		 */
+		sigset_t mask;
+		sigset_t previous;
+
+		::sigfillset(&mask);
+		::pthread_sigmask(SIG_SETMASK, &mask, &previous);
+
+		HID_TRY {
+			writer_thread = std::thread{writer_main};
+		} HID_CATCH(const std::system_error&) {
+			::pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+			writer_state.store(WriterState::FAILED, std::memory_order_release);
+			std::atexit(stop_now);
+			return;
+		}
+
+		::pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+
+		writer_state.store(WriterState::RUNNING, std::memory_order_release);
+		std::atexit(stop_writer);
+	});
+
+	return writer_state.load(std::memory_order_acquire) == WriterState::RUNNING;
+}
+
+void vlog(LogLevel level, LogCategory category, LogMessage message,
+		const LogDevice *device, const char *format, const LogArg *args,
+		size_t count) noexcept {
+	if (!start_writer()) {
+		LogRecord record;
+
+		format_record(record, level, category, message, device, format, args, count);
+		write_now(&record, false);
+		return;
+	}
+
+	size_t pos = write_pos.load(std::memory_order_relaxed);
+
+	do {
+		if (pos - read_pos.load(std::memory_order_acquire) >= RECORDS) {
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			total_dropped.fetch_add(1, std::memory_order_relaxed);
+			wake_writer();
+			return;
+		}
+	} while (!write_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed));
+
+	auto &record = records[pos % RECORDS];
+
+	format_record(record, level, category, message, device, format, args, count);
+	record.ready.store(true, std::memory_order_seq_cst);
+	wake_writer();
+}
+
+void set_log_writer_thread(bool enabled) noexcept {
+	writer_enabled = enabled;
+}
+
+void set_log_journal(const char *path) noexcept {
+	journal_path = path;
+}
+
+void flush_log() noexcept {
+	if (writer_state.load(std::memory_order_acquire) != WriterState::RUNNING
+			|| writer_thread.get_id() == std::this_thread::get_id()) {
+		return;
+	}
+
+	size_t pos = write_pos.load(std::memory_order_acquire);
+	std::unique_lock<std::mutex> lock{writer_mutex};
+
+	writer_cv.notify_one();
+	flushed_cv.wait(lock, [pos] {
+		return static_cast<ptrdiff_t>(read_pos.load(std::memory_order_acquire) - pos) >= 0
+			|| writer_stopping;
+	});
+}
+
+LogStats log_stats() noexcept {
+	return {
+		total_written.load(std::memory_order_relaxed),
+		total_dropped.load(std::memory_order_relaxed),
+	};
+}
+
+} // namespace hid_identify
@@ -1,6 +1,6 @@
 /*
 	qmk-hid-identify - Identify the current OS to QMK device
-	Copyright 2021  Simon Arlott
+	Copyright 2021,2026  Simon Arlott
 
 	This program is free software: you can redistribute it and/or modify
 	it under the terms of the GNU General Public License as published by
@@ -17,11 +17,95 @@
 */
 #pragma once
 
-#include <libintl.h>
 #include <syslog.h>
 
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
 #define LOGGING_HAS_LEVEL_IDS
 
 #define LOGGING_LEVEL_ERROR_ID LOG_ERR
 #define LOGGING_LEVEL_WARNING_ID LOG_WARNING
 #define LOGGING_LEVEL_INFO_ID LOG_INFO
+
+namespace hid_identify {
+
+enum class LogLevel : unsigned short;
+enum class LogCategory : unsigned short;
+enum class LogMessage : unsigned int;
+struct USBDeviceInfo;
+class LogArg;
+
+/* Device that a message is about */
+struct LogDevice {
+	const char *pathname;
+	/* Name of the device, if known */
+	const char *name;
+	/* USB device information, if known */
+	const USBDeviceInfo *info;
+};
+
+/* Translation of a log message format */
+struct LogTranslation {
+	/* Hash of the untranslated format (0 if there is no translation) */
+	uint32_t hash;
+	const char *text;
+};
+
+/* Translations for the current language, indexed by LogMessage */
+extern const LogTranslation *log_translations;
+
+struct LogStats {
+	unsigned long written;
+	unsigned long dropped;
+};
+
+std::string get_strerror();
+
+/*
+ * Get the translation of a log message format, unless the message has a
+ * different format (identified by its hash) or it's not translated.
+ */
+inline const char *log_translate(LogMessage message, uint32_t hash, const char *format) noexcept {
+	const LogTranslation &translation = log_translations[static_cast<size_t>(message)];
+
+	return translation.hash == hash ? translation.text : format;
+}
+
+/*
+ * Use translations of log messages for a locale name (e.g. "de_DE.UTF-8"),
+ * returning false if there are none. This must be set before any messages
+ * are logged.
+ */
+bool set_log_language(const char *locale) noexcept;
+
+/* Use translations for the locale in LC_ALL, LC_MESSAGES or LANG */
+void select_log_language() noexcept;
+
+void vlog(LogLevel level, LogCategory category, LogMessage message,
+	const LogDevice *device, const char *format, const LogArg *args,
+	size_t count) noexcept;
+
+/*
+ * Write messages from a background thread instead of the thread that logs
+ * them, for when multiple devices are being identified at the same time.
+ * This must be set before any messages are logged.
+ */
+void set_log_writer_thread(bool enabled) noexcept;
+
+/*
+ * Send messages to the journal using the socket at this path instead of
+ * writing them to syslog and the console. This must be set before any
+ * messages are logged. By default the journal is used if the standard error
+ * stream is connected to it.
+ */
+void set_log_journal(const char *path) noexcept;
+
+/* Wait for all messages that have already been logged to be written */
+void flush_log() noexcept;
+
+/* Number of messages written and dropped because the buffer was full */
+LogStats log_stats() noexcept;
+
+} // namespace hid_identify
@@ -1,6 +1,6 @@
 /*
 	qmk-hid-identify - Identify the current OS to QMK device
-	Copyright 2021  Simon Arlott
+	Copyright 2021,2026  Simon Arlott
 
 	This program is free software: you can redistribute it and/or modify
 	it under the terms of the GNU General Public License as published by
@@ -15,45 +15,389 @@
 	You should have received a copy of the GNU General Public License
 	along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
+#include <getopt.h>
+#include <stdio.h>
 #include <sysexits.h>
+#include <unistd.h>
 
-#include <iostream>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
+#include "exit-status.h"
 #include "hid-identify.h"
+#include "logging.h"
+#include "report-cache.h"
+#include "sysfs.h"
+#include "sysroot.h"
+#include "usb-overrides.h"
+#ifdef HAVE_MULTI_DEVICE
+#	include "daemon.h"
+#	include "hid-workers.h"
+#endif
+#ifdef HAVE_LIBURING
+#	include "hid-uring.h"
+#endif
+#include "../common/log-filter.h"
 #include "../common/types.h"
 
 using namespace hid_identify;
 
-int main(int argc, char *argv[]) {
-	int exit_ret = 0;
+static constexpr unsigned long MAX_JOBS = 1024;
+static constexpr unsigned long MAX_LOG_RATE_INTERVAL = 86400;
+static constexpr unsigned long MAX_REPEAT = 1000000;
 
-	if (argc < 2) {
-		std::cout << "Usage: " << argv[0] << " <hidraw device>..." << std::endl;
-		return EX_USAGE;
+static void usage(const char *name) {
+#ifdef HAVE_MULTI_DEVICE
+	::dprintf(STDOUT_FILENO,
+		"Usage: %s [options] [--jobs <count>] <hidraw device>...\n"
+		"       %s [options] [--jobs <count>] --all\n"
+		"       %s [options] [--jobs <count>] --daemon\n",
+		name, name, name);
+#else
+	::dprintf(STDOUT_FILENO, "Usage: %s [options] <hidraw device>\n", name);
+#endif
+	::dprintf(STDOUT_FILENO,
+		"       %s [options] --repeat <count> <hidraw device>\n"
+		"\n"
+		"Options: --sysroot <dir>\n"
+		"         --log-level error|warning|info\n"
+		"         --log-rate-limit <messages>[/<seconds>]\n",
+		name);
+}
+
+static bool parse_log_level(const char *value) {
+	static const std::array<std::pair<const char*, LogLevel>, 3> levels{{
+		{"error", LogLevel::ERROR},
+		{"warning", LogLevel::WARNING},
+		{"info", LogLevel::INFO},
+	}};
+
+	for (const auto& level : levels) {
+		if (!std::strcmp(value, level.first)) {
+			set_log_level(level.second);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* Maximum messages in each category per interval (default 1 second) */
+static bool parse_log_rate_limit(const char *value) {
+	char *end = nullptr;
+	unsigned long messages = std::strtoul(value, &end, 10);
+	unsigned long seconds = 1;
+
+	if (end == value || messages > UINT_MAX) {
+		return false;
+	}
+
+	if (*end == '/') {
+		const char *interval = end + 1;
+
+		seconds = std::strtoul(interval, &end, 10);
+		if (end == interval || seconds < 1 || seconds > MAX_LOG_RATE_INTERVAL) {
+			return false;
+		}
+	}
+
+	if (*end) {
+		return false;
+	}
+
+	set_log_rate_limit(messages, std::chrono::seconds{seconds});
+	return true;
+}
+
+#ifdef HAVE_MULTI_DEVICE
+static int command_daemon(unsigned int jobs) {
+	HID_TRY {
+		return LinuxHIDDaemon(jobs).run();
+	} HID_CATCH(const Exception&) {
+		return exception_exit_status();
+	}
+}
+#endif
+
+static std::vector<int> identify_devices(int argc, char *argv[], unsigned int jobs) {
+#ifdef HAVE_MULTI_DEVICE
+	if (jobs > 1) {
+		LinuxHIDWorkers workers{jobs};
+
+		for (int i = 0; i < argc; i++) {
+			workers.add(argv[i]);
+		}
+
+		return workers.run();
 	}
+#else
+	(void)jobs;
+#endif
 
-	try {
-		for (int i = 1; i < argc; i++) {
-			try {
-				LinuxHIDDevice(argv[i]).identify();
-			} catch (const UnavailableDevice&) {
-				exit_ret = exit_ret ? exit_ret : EX_NOINPUT;
-			} catch (const MalformedHIDReportDescriptor&) {
-				exit_ret = exit_ret ? exit_ret : EX_DATAERR;
-			} catch (const OSError&) {
-				exit_ret = exit_ret ? exit_ret : EX_OSERR;
-			} catch (const IOError&) {
-				exit_ret = exit_ret ? exit_ret : EX_IOERR;
-			} catch (const UnsupportedDevice&) {
-				exit_ret = exit_ret ? exit_ret : EX_UNAVAILABLE;
-			} catch (const Exception&) {
-				exit_ret = exit_ret ? exit_ret : EX_SOFTWARE;
+#ifdef HAVE_LIBURING
+	/*
+	 * Setting up a ring costs more than it saves for a single device
+	 * (e.g. when run by udev), so only use it for multiple devices.
+	 */
+	if (argc > 1) {
+		LinuxHIDUring uring;
+
+		if (uring) {
+			for (int i = 0; i < argc; i++) {
+				uring.add(argv[i]);
 			}
+
+			return uring.run();
+		}
+	}
+#endif
+
+	std::vector<int> status;
+
+	/*
+	 * Writes to hidraw devices block until the USB transfer completes, so
+	 * identify devices one at a time unless there are multiple threads.
+	 */
+	status.reserve(argc);
+	for (int i = 0; i < argc; i++) {
+		HID_TRY {
+			status.push_back(rejection_exit_status(LinuxHIDDevice(argv[i]).identify()));
+		} HID_CATCH(const Exception&) {
+			status.push_back(exception_exit_status());
+		}
+	}
+
+	return status;
+}
+
+static int command_identify(int argc, char *argv[], unsigned int jobs) {
+	int exit_ret = 0;
+
+	HID_TRY {
+		for (int status : identify_devices(argc, argv, jobs)) {
+			exit_ret = exit_ret ? exit_ret : status;
+		}
+	} HID_CATCH(const Exception&) {
+		return exception_exit_status();
+	}
+
+	return exit_ret;
+}
+
+#ifdef HAVE_MULTI_DEVICE
+static int command_identify_all(unsigned int jobs) {
+	int exit_ret = 0;
+
+	HID_TRY {
+		LinuxHIDWorkers workers{jobs};
+
+		for (auto& device : HIDRawSysfs::instance().allowed_devices()) {
+			workers.add(std::move(device));
+		}
+
+		for (int status : workers.run()) {
+			exit_ret = exit_ret ? exit_ret : status;
 		}
-	} catch (...) {
-		throw;
+	} HID_CATCH(const Exception&) {
+		return exception_exit_status();
 	}
 
 	return exit_ret;
 }
+#endif
+
+/* Print the minimum, median, 99th percentile and maximum time of each stage */
+static void print_stage_times(std::vector<HIDDevice::StageTimes> &runs) {
+	::dprintf(STDOUT_FILENO, "%-18s%12s%12s%12s%12s\n", "stage (us)", "min", "p50", "p99", "max");
+
+	for (size_t stage = 0; stage <= HIDDevice::STAGES; stage++) {
+		std::vector<uint64_t> times;
+
+		times.reserve(runs.size());
+		for (const auto& run : runs) {
+			if (stage < HIDDevice::STAGES) {
+				times.push_back(run[stage]);
+			} else {
+				times.push_back(std::accumulate(run.begin(), run.end(), uint64_t{0}));
+			}
+		}
+
+		std::sort(times.begin(), times.end());
+
+		/* Nearest rank */
+		auto percentile = [&times] (size_t n) {
+			return times[std::max((times.size() * n + 99) / 100, size_t{1}) - 1] / 1000.0;
+		};
+
+		::dprintf(STDOUT_FILENO, "%-18s%12.1f%12.1f%12.1f%12.1f\n",
+			stage < HIDDevice::STAGES ? HIDDevice::STAGE_NAMES[stage] : "total",
+			times.front() / 1000.0, percentile(50), percentile(99), times.back() / 1000.0);
+	}
+}
+
+/* Identify a device repeatedly, measuring how long each stage takes */
+static int command_repeat(const char *pathname, unsigned long count) {
+	std::vector<HIDDevice::StageTimes> runs;
+
+	runs.reserve(count);
+
+	HID_TRY {
+		for (unsigned long i = 0; i < count; i++) {
+			LinuxHIDDevice device{pathname};
+
+			runs.push_back({});
+			device.measure_stages(&runs.back());
+
+			Rejection rejection = device.identify();
+			if (rejection != Rejection::NONE) {
+				return rejection_exit_status(rejection);
+			}
+		}
+	} HID_CATCH(const Exception&) {
+		return exception_exit_status();
+	}
+
+	print_stage_times(runs);
+	return 0;
+}
+
+int main(int argc, char *argv[]) {
+	static const struct option options[] = {
+		{ "all", no_argument, nullptr, 'a' },
+		{ "daemon", no_argument, nullptr, 'd' },
+		{ "jobs", required_argument, nullptr, 'j' },
+		{ "log-level", required_argument, nullptr, 'l' },
+		{ "log-rate-limit", required_argument, nullptr, 'L' },
+		{ "repeat", required_argument, nullptr, 'R' },
+		{ "sysroot", required_argument, nullptr, 'r' },
+		{ nullptr, 0, nullptr, 0 },
+	};
+	bool all = false;
+	bool daemon = false;
+	unsigned int jobs = 0;
+	unsigned long repeat = 0;
+	int opt;
+
+	select_log_language();
+
+	while ((opt = ::getopt_long(argc, argv, "+j:", options, nullptr)) != -1) {
+		switch (opt) {
+		case 'a':
+			all = true;
+			break;
+
+		case 'd':
+			daemon = true;
+			break;
+
+		case 'j': {
+				char *end = nullptr;
+				unsigned long value = std::strtoul(optarg, &end, 10);
+
+				if (!optarg[0] || *end || value < 1 || value > MAX_JOBS) {
+					usage(argv[0]);
+					return EX_USAGE;
+				}
+
+				jobs = value;
+				break;
+			}
+
+		case 'l':
+			if (!parse_log_level(optarg)) {
+				usage(argv[0]);
+				return EX_USAGE;
+			}
+			break;
+
+		case 'L':
+			if (!parse_log_rate_limit(optarg)) {
+				usage(argv[0]);
+				return EX_USAGE;
+			}
+			break;
+
+		case 'R': {
+				char *end = nullptr;
+				unsigned long value = std::strtoul(optarg, &end, 10);
+
+				if (!optarg[0] || *end || value < 1 || value > MAX_REPEAT) {
+					usage(argv[0]);
+					return EX_USAGE;
+				}
+
+				repeat = value;
+				break;
+			}
+
+		case 'r':
+			set_sysroot(optarg);
+			break;
+
+		default:
+			usage(argv[0]);
+			return EX_USAGE;
+		}
+	}
+
+	if ((all && daemon) || ((all || daemon) ? (optind != argc) : (optind == argc))
+			|| (repeat && (all || daemon || jobs || optind + 1 != argc))) {
+		usage(argv[0]);
+		return EX_USAGE;
+	}
+
+#ifndef HAVE_MULTI_DEVICE
+	/* Errors exit the process, so other devices wouldn't be identified */
+	if (all || daemon || jobs || optind + 1 != argc) {
+		usage(argv[0]);
+		return EX_USAGE;
+	}
+#endif
+
+	/* Identify all devices in parallel by default */
+	if (all || daemon) {
+		jobs = jobs ? jobs : std::clamp(std::thread::hardware_concurrency(), 1U, 16U);
+	}
+
+	/* Avoid blocking the threads identifying devices while messages are written */
+	set_log_writer_thread(all || daemon || jobs > 1);
+
+	/*
+	 * Opening the cache takes longer than parsing one report descriptor, so
+	 * it's only used for multiple devices (and never for --repeat, which
+	 * would then only parse the report descriptor the first time).
+	 */
+	if (all || daemon || argc - optind > 1) {
+		HIDReportCache::enable();
+	}
+
+	load_usb_device_overrides();
+
+	HID_TRY {
+#ifdef HAVE_MULTI_DEVICE
+		if (all) {
+			return command_identify_all(jobs);
+		} else if (daemon) {
+			return command_daemon(jobs);
+		}
+#endif
+
+		if (repeat) {
+			return command_repeat(argv[optind], repeat);
+		} else {
+			return command_identify(argc - optind, &argv[optind], jobs);
+		}
+	} HID_CATCH(...) {
+		HID_RETHROW;
+	}
+}
@@ -0,0 +1,231 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "report-cache.h"
+
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+
+#include "sysroot.h"
+#include "unique-fd.h"
+
+namespace hid_identify {
+
+static constexpr const char *CACHE_DIRECTORY = "/run/qmk-hid-identify";
+static constexpr const char *CACHE_FILENAME = "/run/qmk-hid-identify/report-descriptors";
+
+/* Change the version if the contents of entries or their meaning changes */
+static constexpr uint32_t CACHE_MAGIC = 0x51484944; /* "QHID" */
+static constexpr uint32_t CACHE_VERSION = 1;
+static constexpr uint32_t CACHE_ENTRIES = 256;
+
+struct CacheHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t entries;
+	uint32_t reserved;
+};
+
+struct CacheEntry {
+	uint64_t hash;
+	uint32_t size;
+	uint32_t report_count;
+	uint32_t checksum;
+	uint32_t reserved;
+};
+
+static constexpr size_t CACHE_SIZE = sizeof(CacheHeader)
+	+ CACHE_ENTRIES * sizeof(CacheEntry);
+
+static bool enabled = false;
+
+/* 64-bit FNV-1a */
+static uint64_t hash(const uint8_t *data, size_t size) {
+	uint64_t value = 0xCBF29CE484222325ULL;
+
+	for (size_t i = 0; i < size; i++) {
+		value ^= data[i];
+		value *= 0x100000001B3ULL;
+	}
+
+	return value;
+}
+
+static uint32_t checksum(const CacheEntry &entry) {
+	const uint32_t values[] = {
+		static_cast<uint32_t>(entry.hash),
+		static_cast<uint32_t>(entry.hash >> 32),
+		entry.size,
+		entry.report_count,
+	};
+
+	/* Never 0, so that empty entries are always invalid */
+	return static_cast<uint32_t>(hash(reinterpret_cast<const uint8_t*>(values), sizeof(values))) | 1;
+}
+
+HIDReportCache& HIDReportCache::instance() {
+	static HIDReportCache cache;
+	return cache;
+}
+
+void HIDReportCache::enable() noexcept {
+	enabled = true;
+}
+
+HIDReportCache::HIDReportCache() {
+	if (!enabled) {
+		return;
+	}
+
+	std::string filename = sysroot_path(CACHE_FILENAME);
+
+	::mkdir(sysroot_path(CACHE_DIRECTORY).c_str(), 0755);
+
+	if (open(filename)) {
+		return;
+	}
+
+	/*
+	 * The file doesn't exist or has a different layout, so create a new one
+	 * and rename it into place. Processes that still have the old file open
+	 * continue to use it without being affected by the new file.
+	 */
+	if (create(filename)) {
+		open(filename);
+	}
+}
+
+HIDReportCache::~HIDReportCache() {
+	if (map_ != nullptr) {
+		::munmap(map_, CACHE_SIZE);
+	}
+}
+
+bool HIDReportCache::create(const std::string &filename) {
+	std::string temp_filename = filename + ".XXXXXX";
+	unique_fd fd{::mkostemp(&temp_filename[0], O_CLOEXEC)};
+
+	if (!fd) {
+		return false;
+	}
+
+	CacheHeader header{ CACHE_MAGIC, CACHE_VERSION, CACHE_ENTRIES, 0 };
+
+	if (::fchmod(fd.get(), 0644) < 0
+			|| ::ftruncate(fd.get(), CACHE_SIZE) < 0
+			|| ::pwrite(fd.get(), &header, sizeof(header), 0) != sizeof(header)
+			|| ::rename(temp_filename.c_str(), filename.c_str()) < 0) {
+		::unlink(temp_filename.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+bool HIDReportCache::open(const std::string &filename) {
+	bool writable = true;
+	struct stat st{};
+
+	fd_ = unique_fd{::open(filename.c_str(), O_RDWR | O_NOFOLLOW | O_CLOEXEC)};
+	if (!fd_) {
+		writable = false;
+		fd_ = unique_fd{::open(filename.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC)};
+	}
+
+	/* The file is never resized after it has been created */
+	if (!fd_ || ::fstat(fd_.get(), &st) < 0 || st.st_size != (off_t)CACHE_SIZE) {
+		fd_.clear();
+		return false;
+	}
+
+	void *map = ::mmap(nullptr, CACHE_SIZE, writable ? (PROT_READ | PROT_WRITE) : PROT_READ,
+		MAP_SHARED, fd_.get(), 0);
+	if (map == MAP_FAILED) {
+		fd_.clear();
+		return false;
+	}
+
+	CacheHeader header;
+	std::memcpy(&header, map, sizeof(header));
+
+	if (header.magic != CACHE_MAGIC || header.version != CACHE_VERSION
+			|| header.entries != CACHE_ENTRIES) {
+		::munmap(map, CACHE_SIZE);
+		fd_.clear();
+		return false;
+	}
+
+	map_ = map;
+	writable_ = writable;
+	return true;
+}
+
+bool HIDReportCache::lookup(const uint8_t *report_descriptor, size_t size, uint32_t &report_count) const {
+	if (map_ == nullptr) {
+		return false;
+	}
+
+	uint64_t value = hash(report_descriptor, size);
+	auto entries = reinterpret_cast<const uint8_t*>(map_) + sizeof(CacheHeader);
+	CacheEntry entry;
+
+	std::memcpy(&entry, entries + (value % CACHE_ENTRIES) * sizeof(CacheEntry), sizeof(entry));
+
+	if (entry.hash != value || entry.size != size || entry.checksum != checksum(entry)) {
+		return false;
+	}
+
+	report_count = entry.report_count;
+	return true;
+}
+
+void HIDReportCache::store(const uint8_t *report_descriptor, size_t size, uint32_t report_count) {
+	if (!writable_) {
+		return;
+	}
+
+	/* File locks don't exclude other threads using the same file */
+	std::lock_guard<std::mutex> lock{mutex_};
+
+	if (::flock(fd_.get(), LOCK_EX) < 0) {
+		return;
+	}
+
+	CacheEntry entry{};
+
+	entry.hash = hash(report_descriptor, size);
+	entry.size = size;
+	entry.report_count = report_count;
+	entry.checksum = checksum(entry);
+
+	auto entries = reinterpret_cast<uint8_t*>(map_) + sizeof(CacheHeader);
+	std::memcpy(entries + (entry.hash % CACHE_ENTRIES) * sizeof(CacheEntry), &entry, sizeof(entry));
+
+	::flock(fd_.get(), LOCK_UN);
+}
+
+} // namespace hid_identify
@@ -0,0 +1,74 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <sys/types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "unique-fd.h"
+
+namespace hid_identify {
+
+/*
+ * Cache of report descriptor parse results, shared between processes using a
+ * memory mapped file under /run. Entries are found by a hash of the report
+ * descriptor and contain the raw HID report count (0 if the descriptor is not
+ * for a QMK raw HID interface).
+ *
+ * Updates are serialised with a file lock but lookups don't need to lock the
+ * file. Each entry has a checksum so that partially written entries (from a
+ * concurrent update or a process that crashed) are ignored. The file is
+ * replaced (never modified in place) if it has a different layout.
+ *
+ * The cache is only used if it has been enabled, and not if the file can't
+ * be opened or created.
+ */
+class HIDReportCache {
+public:
+	static HIDReportCache& instance();
+
+	/*
+	 * Use the cache, which is only worth opening when identifying multiple
+	 * devices. This must be called before the cache is first used.
+	 */
+	static void enable() noexcept;
+
+	bool lookup(const uint8_t *report_descriptor, size_t size, uint32_t &report_count) const;
+	void store(const uint8_t *report_descriptor, size_t size, uint32_t report_count);
+
+	HIDReportCache(const HIDReportCache&) = delete;
+	HIDReportCache& operator=(const HIDReportCache&) = delete;
+
+private:
+	HIDReportCache();
+	~HIDReportCache();
+
+	static bool create(const std::string &filename);
+	bool open(const std::string &filename);
+
+	unique_fd fd_;
+	void *map_ = nullptr;
+	bool writable_ = false;
+	std::mutex mutex_;
+};
+
+} // namespace hid_identify
@@ -0,0 +1,138 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "report-desc-scan.h"
+
+#if defined(HAVE_FIND_RAW_USAGE_PAGE_SSE2) || defined(HAVE_FIND_RAW_USAGE_PAGE_AVX2)
+# include <immintrin.h>
+#endif
+
+#include <cstddef>
+#include <cstdint>
+
+#include "../common/hid-device.h"
+
+namespace hid_identify {
+
+/*
+ * A 2 byte Usage Page item is 0x06 followed by the value (little endian) and
+ * a 4 byte Usage Page item is 0x07 followed by the value, so both start with
+ * (key & 0xFE) == 0x06 and the low 16 bits of the value.
+ */
+static constexpr uint8_t USAGE_PAGE_KEY_MASK = 0xFE;
+static constexpr uint8_t USAGE_PAGE_KEY = 0x06;
+static constexpr uint8_t RAW_USAGE_PAGE_LOW = HIDDevice::RAW_USAGE_PAGE & 0xFF;
+static constexpr uint8_t RAW_USAGE_PAGE_HIGH = (HIDDevice::RAW_USAGE_PAGE >> 8) & 0xFF;
+
+static inline bool raw_usage_page_at(const uint8_t *pos) {
+	return (pos[0] & USAGE_PAGE_KEY_MASK) == USAGE_PAGE_KEY
+		&& pos[1] == RAW_USAGE_PAGE_LOW
+		&& pos[2] == RAW_USAGE_PAGE_HIGH;
+}
+
+static bool find_raw_usage_page_scalar(const uint8_t *report_descriptor, size_t pos, size_t size) {
+	for (; pos + 3 <= size; pos++) {
+		if (raw_usage_page_at(&report_descriptor[pos])) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool find_raw_usage_page_scalar(const uint8_t *report_descriptor, size_t size) {
+	return find_raw_usage_page_scalar(report_descriptor, 0, size);
+}
+
+#ifdef HAVE_FIND_RAW_USAGE_PAGE_SSE2
+bool find_raw_usage_page_sse2(const uint8_t *report_descriptor, size_t size) {
+	const __m128i key_mask = _mm_set1_epi8((char)USAGE_PAGE_KEY_MASK);
+	const __m128i key = _mm_set1_epi8((char)USAGE_PAGE_KEY);
+	const __m128i low = _mm_set1_epi8((char)RAW_USAGE_PAGE_LOW);
+	const __m128i high = _mm_set1_epi8((char)RAW_USAGE_PAGE_HIGH);
+	size_t pos = 0;
+
+	/* Check 16 positions at a time, each needing 3 bytes */
+	for (; pos + 16 + 2 <= size; pos += 16) {
+		const uint8_t *data = &report_descriptor[pos];
+		__m128i match = _mm_cmpeq_epi8(_mm_and_si128(
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(data)), key_mask), key);
+
+		match = _mm_and_si128(match, _mm_cmpeq_epi8(
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 1)), low));
+		match = _mm_and_si128(match, _mm_cmpeq_epi8(
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 2)), high));
+
+		if (_mm_movemask_epi8(match)) {
+			return true;
+		}
+	}
+
+	return find_raw_usage_page_scalar(report_descriptor, pos, size);
+}
+#endif
+
+#ifdef HAVE_FIND_RAW_USAGE_PAGE_AVX2
+__attribute__((target("avx2")))
+bool find_raw_usage_page_avx2(const uint8_t *report_descriptor, size_t size) {
+	const __m256i key_mask = _mm256_set1_epi8((char)USAGE_PAGE_KEY_MASK);
+	const __m256i key = _mm256_set1_epi8((char)USAGE_PAGE_KEY);
+	const __m256i low = _mm256_set1_epi8((char)RAW_USAGE_PAGE_LOW);
+	const __m256i high = _mm256_set1_epi8((char)RAW_USAGE_PAGE_HIGH);
+	size_t pos = 0;
+
+	/* Check 32 positions at a time, each needing 3 bytes */
+	for (; pos + 32 + 2 <= size; pos += 32) {
+		const uint8_t *data = &report_descriptor[pos];
+		__m256i match = _mm256_cmpeq_epi8(_mm256_and_si256(
+			_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data)), key_mask), key);
+
+		match = _mm256_and_si256(match, _mm256_cmpeq_epi8(
+			_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + 1)), low));
+		match = _mm256_and_si256(match, _mm256_cmpeq_epi8(
+			_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + 2)), high));
+
+		if (_mm256_movemask_epi8(match)) {
+			return true;
+		}
+	}
+
+	return find_raw_usage_page_scalar(report_descriptor, pos, size);
+}
+
+bool find_raw_usage_page_avx2_supported() {
+	static const bool supported = __builtin_cpu_supports("avx2");
+
+	return supported;
+}
+#endif
+
+bool find_raw_usage_page(const uint8_t *report_descriptor, size_t size) {
+#if defined(HAVE_FIND_RAW_USAGE_PAGE_AVX2)
+	if (find_raw_usage_page_avx2_supported()) {
+		return find_raw_usage_page_avx2(report_descriptor, size);
+	}
+#endif
+
+#if defined(HAVE_FIND_RAW_USAGE_PAGE_SSE2)
+	return find_raw_usage_page_sse2(report_descriptor, size);
+#else
+	return find_raw_usage_page_scalar(report_descriptor, size);
+#endif
+}
+
+} // namespace hid_identify
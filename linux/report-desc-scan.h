@@ -0,0 +1,51 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace hid_identify {
+
+/*
+ * Check if a report descriptor could have the QMK raw HID interface by
+ * looking for a Usage Page item (2 or 4 bytes) with a value of 0xFF60
+ * anywhere in it. Without one, the report descriptor doesn't need to be
+ * parsed.
+ *
+ * This can return true for report descriptors that don't have the usage page
+ * (e.g. if it's part of the data of another item) but never returns false
+ * for report descriptors that do.
+ */
+bool find_raw_usage_page(const uint8_t *report_descriptor, size_t size);
+
+/* Implementations of find_raw_usage_page() */
+bool find_raw_usage_page_scalar(const uint8_t *report_descriptor, size_t size);
+
+#if defined(__SSE2__)
+# define HAVE_FIND_RAW_USAGE_PAGE_SSE2
+bool find_raw_usage_page_sse2(const uint8_t *report_descriptor, size_t size);
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+# define HAVE_FIND_RAW_USAGE_PAGE_AVX2
+bool find_raw_usage_page_avx2(const uint8_t *report_descriptor, size_t size);
+bool find_raw_usage_page_avx2_supported();
+#endif
+
+} // namespace hid_identify
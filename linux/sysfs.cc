@@ -0,0 +1,224 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "sysfs.h"
+
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <sys/types.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <linux/input.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../common/hid-device.h"
+#include "../common/types.h"
+#include "sysroot.h"
+#include "unique-fd.h"
+
+namespace hid_identify {
+
+static constexpr int DIR_FLAGS = O_PATH | O_DIRECTORY | O_CLOEXEC;
+static constexpr size_t DIRENT_BUFFER_SIZE = 32768;
+
+/* Read a small attribute file, returning the number of bytes read or -1 */
+static ssize_t read_attribute(int dir_fd, const char *name, char *buf, size_t size) {
+	unique_fd fd{::openat(dir_fd, name, O_RDONLY | O_CLOEXEC)};
+	if (!fd) {
+		return -1;
+	}
+
+	ssize_t len = ::read(fd.get(), buf, size - 1);
+	if (len < 0) {
+		return -1;
+	}
+
+	buf[len] = '\0';
+	return len;
+}
+
+/* Find the value of a "KEY=value" line in a uevent file */
+static const char *uevent_value(const char *uevent, const char *key, size_t *len) {
+	size_t key_len = std::strlen(key);
+
+	for (const char *line = uevent; *line; ) {
+		const char *end = std::strchr(line, '\n');
+
+		if (end == nullptr) {
+			end = line + std::strlen(line);
+		}
+
+		if ((size_t)(end - line) > key_len && !std::strncmp(line, key, key_len)
+				&& line[key_len] == '=') {
+			*len = end - line - key_len - 1;
+			return line + key_len + 1;
+		}
+
+		line = *end ? end + 1 : end;
+	}
+
+	return nullptr;
+}
+
+const HIDRawSysfs& HIDRawSysfs::instance() {
+	static const HIDRawSysfs sysfs{sysroot()};
+	return sysfs;
+}
+
+HIDRawSysfs::HIDRawSysfs(const std::string &root)
+		: class_fd_(::open((root + "/sys/class/hidraw").c_str(), DIR_FLAGS)),
+		char_fd_(::open((root + "/sys/dev/char").c_str(), DIR_FLAGS)) {
+}
+
+unique_fd HIDRawSysfs::open_device(const char *name) const {
+	std::array<char, 64> path{};
+
+	if (!class_fd_ || std::strchr(name, '/') != nullptr) {
+		return {};
+	}
+
+	if (std::snprintf(path.data(), path.size(), "%s/device", name) >= (int)path.size()) {
+		return {};
+	}
+
+	return unique_fd{::openat(class_fd_.get(), path.data(), DIR_FLAGS)};
+}
+
+unique_fd HIDRawSysfs::open_device(dev_t rdev) const {
+	std::array<char, 64> path{};
+
+	if (!char_fd_) {
+		return {};
+	}
+
+	std::snprintf(path.data(), path.size(), "%u:%u/device", major(rdev), minor(rdev));
+
+	return unique_fd{::openat(char_fd_.get(), path.data(), DIR_FLAGS)};
+}
+
+std::vector<HIDRawSysfsDevice> HIDRawSysfs::allowed_devices() const {
+	std::vector<HIDRawSysfsDevice> devices;
+
+	if (!class_fd_) {
+		return devices;
+	}
+
+	/* The directory needs to be opened for reading to list its contents */
+	unique_fd dir_fd{::openat(class_fd_.get(), ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC)};
+	if (!dir_fd) {
+		return devices;
+	}
+
+	std::vector<char> buf(DIRENT_BUFFER_SIZE);
+	long len;
+
+	/* getdents64() is not available in glibc before 2.30 */
+	while ((len = ::syscall(SYS_getdents64, dir_fd.get(), buf.data(), buf.size())) > 0) {
+		for (long pos = 0; pos < len; ) {
+			auto entry = reinterpret_cast<const struct dirent64*>(&buf[pos]);
+
+			pos += entry->d_reclen;
+
+			if (entry->d_name[0] == '.'
+					|| (entry->d_type != DT_LNK && entry->d_type != DT_UNKNOWN)) {
+				continue;
+			}
+
+			HIDRawSysfsDevice device{entry->d_name, open_device(entry->d_name), {}, {}};
+
+			if (device.fd && device_info(device.fd.get(), device.info, device.phys)
+					&& HIDDevice::device_allowed(device.info)) {
+				devices.push_back(std::move(device));
+			}
+		}
+	}
+
+	std::sort(devices.begin(), devices.end(),
+		[] (const HIDRawSysfsDevice &a, const HIDRawSysfsDevice &b) {
+			return a.name.size() != b.name.size() ? a.name.size() < b.name.size() : a.name < b.name;
+		});
+
+	return devices;
+}
+
+bool HIDRawSysfs::device_info(int device_fd, USBDeviceInfo &device_info,
+		std::array<char, HID_PHYS_SIZE> &phys) {
+	std::array<char, 4096> uevent{};
+
+	if (read_attribute(device_fd, "uevent", uevent.data(), uevent.size()) < 0) {
+		return false;
+	}
+
+	size_t len = 0;
+	const char *value = uevent_value(uevent.data(), "HID_ID", &len);
+	unsigned int bus, vendor, product;
+
+	if (value == nullptr || std::sscanf(value, "%x:%x:%x", &bus, &vendor, &product) != 3) {
+		return false;
+	}
+
+	device_info = { (uint16_t)vendor, (uint16_t)product, -1 };
+
+	value = uevent_value(uevent.data(), "HID_PHYS", &len);
+	if (value != nullptr) {
+		len = std::min(len, phys.size() - 1);
+		std::copy(value, value + len, phys.begin());
+		phys[len] = '\0';
+	} else {
+		phys[0] = '\0';
+	}
+
+	/* The parent of a USB HID device is the USB interface */
+	if (bus == BUS_USB) {
+		std::array<char, 16> interface_number{};
+
+		if (read_attribute(device_fd, "../bInterfaceNumber",
+				interface_number.data(), interface_number.size()) > 0) {
+			char *end = nullptr;
+			unsigned long number = std::strtoul(interface_number.data(), &end, 16);
+
+			if (end != interface_number.data() && (*end == '\n' || *end == '\0')
+					&& number <= INT16_MAX) {
+				device_info.interface_number = number;
+			}
+		}
+	}
+
+	return true;
+}
+
+ssize_t HIDRawSysfs::report_descriptor(int device_fd, uint8_t *buf, size_t size) {
+	unique_fd fd{::openat(device_fd, "report_descriptor", O_RDONLY | O_CLOEXEC)};
+	if (!fd) {
+		return -1;
+	}
+
+	return ::pread(fd.get(), buf, size, 0);
+}
+
+} // namespace hid_identify
@@ -0,0 +1,88 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <sys/types.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../common/types.h"
+#include "unique-fd.h"
+
+namespace hid_identify {
+
+/* Size of the physical location of a HID device, including the terminator */
+static constexpr size_t HID_PHYS_SIZE = 256;
+
+/* A hidraw device found in sysfs */
+struct HIDRawSysfsDevice {
+	std::string name;
+	unique_fd fd;
+	USBDeviceInfo info;
+	std::array<char, HID_PHYS_SIZE> phys;
+};
+
+/*
+ * Read hidraw device information from sysfs without opening the device.
+ *
+ * The sysfs directories are kept open so that each device lookup only needs
+ * to resolve a short path relative to them.
+ */
+class HIDRawSysfs {
+public:
+	/* Using the root directory from sysroot() */
+	static const HIDRawSysfs& instance();
+
+	/* Using a specific root directory (empty for the real root) */
+	explicit HIDRawSysfs(const std::string &root);
+
+	/* Open the device directory of a hidraw node by name (e.g. "hidraw0") */
+	unique_fd open_device(const char *name) const;
+
+	/* Open the device directory of a hidraw node by device number */
+	unique_fd open_device(dev_t rdev) const;
+
+	/*
+	 * List all hidraw devices that could be allowed based on their device
+	 * information, in order of name.
+	 */
+	std::vector<HIDRawSysfsDevice> allowed_devices() const;
+
+	/*
+	 * Read the USB device information and physical location from an open
+	 * device directory. Returns false if the information is not available.
+	 */
+	static bool device_info(int device_fd, USBDeviceInfo &device_info,
+		std::array<char, HID_PHYS_SIZE> &phys);
+
+	/*
+	 * Read the report descriptor from an open device directory directly into
+	 * the buffer. Returns the length of the descriptor or -1 on error.
+	 */
+	static ssize_t report_descriptor(int device_fd, uint8_t *buf, size_t size);
+
+private:
+	unique_fd class_fd_;
+	unique_fd char_fd_;
+};
+
+} // namespace hid_identify
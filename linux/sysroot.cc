@@ -0,0 +1,43 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "sysroot.h"
+
+#include <string>
+
+namespace hid_identify {
+
+static std::string root;
+
+void set_sysroot(const std::string &path) {
+	root = path;
+
+	/* Avoid a double "/" when the path is appended */
+	while (!root.empty() && root.back() == '/') {
+		root.pop_back();
+	}
+}
+
+const std::string& sysroot() {
+	return root;
+}
+
+std::string sysroot_path(const std::string &path) {
+	return root + path;
+}
+
+} // namespace hid_identify
@@ -0,0 +1,37 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <string>
+
+namespace hid_identify {
+
+/*
+ * Set the root directory that the fixed paths (in /dev, /etc, /run and /sys)
+ * are relative to, so that a synthetic tree can be used instead of the real
+ * one. This must be set before any of them are used.
+ */
+void set_sysroot(const std::string &path);
+
+/* Current root directory, which is empty for the real root */
+const std::string& sysroot();
+
+/* Get the location of an absolute path within the root directory */
+std::string sysroot_path(const std::string &path);
+
+} // namespace hid_identify
@@ -0,0 +1,93 @@
+/*
+	qmk-hid-identify - Identify the current OS to QMK device
+	Copyright 2026  Simon Arlott
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "usb-overrides.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <errno.h>
+#include <fcntl.h>
+
+#include <string>
+#include <vector>
+
+#include "../common/log-filter.h"
+#include "../common/log-format.h"
+#include "../common/types.h"
+#include "../common/usb-vid-pid.h"
+#include "logging.h"
+#include "sysroot.h"
+#include "unique-fd.h"
+
+namespace hid_identify {
+
+static constexpr const char *OVERRIDES_FILENAME = "/etc/qmk-hid-identify/usb-vid-pid.txt";
+
+template <class Format, class... Args>
+static void log(LogLevel level, LogCategory category, LogMessage message,
+		Format format, const Args&... args) noexcept {
+	if (log_enabled(level, category)) {
+		LogArgs values{format, args...};
+
+		vlog(level, category, message, nullptr, values.format(message), values.data(), values.size());
+	}
+}
+
+void load_usb_device_overrides() noexcept {
+	std::string filename = sysroot_path(OVERRIDES_FILENAME);
+	unique_fd fd{::open(filename.c_str(), O_RDONLY | O_CLOEXEC)};
+	if (!fd) {
+		if (errno != ENOENT) {
+			log(LogLevel::WARNING, LogCategory::OS_ERROR, LogMessage::SVC_OS_FUNC_ERROR_CODE_1,
+				LOG_FORMAT("%s: %s"), filename.c_str(), get_strerror().c_str());
+		}
+		return;
+	}
+
+	struct stat st{};
+	if (::fstat(fd.get(), &st) < 0 || st.st_size == 0) {
+		return;
+	}
+
+	void *data = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd.get(), 0);
+	if (data == MAP_FAILED) {
+		log(LogLevel::WARNING, LogCategory::OS_ERROR, LogMessage::SVC_OS_FUNC_ERROR_CODE_1,
+			LOG_FORMAT("%s: %s"), filename.c_str(), get_strerror().c_str());
+		return;
+	}
+
+	HID_TRY {
+		std::vector<USBDeviceOverride> overrides;
+		size_t error_line = 0;
+
+		if (usb_device_parse_overrides(static_cast<const char*>(data), st.st_size,
+				overrides, error_line)) {
+			usb_device_set_overrides(overrides);
+		} else {
+			log(LogLevel::WARNING, LogCategory::SERVICE, LogMessage::SVC_DEVICE_OVERRIDES_INVALID,
+				LOG_FORMAT("%s: Invalid device on line %s, ignoring all overrides"),
+				filename.c_str(), error_line);
+		}
+	} HID_CATCH(...) {
+		/* Only possible if memory allocation fails */
+	}
+
+	::munmap(data, st.st_size);
+}
+
+} // namespace hid_identify
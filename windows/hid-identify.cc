@@ -1,6 +1,6 @@
 /*
 	qmk-hid-identify - Identify the current OS to QMK device
-	Copyright 2021  Simon Arlott
+	Copyright 2021,2026  Simon Arlott
 
 	This program is free software: you can redistribute it and/or modify
 	it under the terms of the GNU General Public License as published by
@@ -29,8 +29,9 @@ extern "C" {
 #endif
 
 #include <algorithm>
+#include <array>
 #include <cctype>
-#include <cstdarg>
+#include <cstddef>
 #include <cwctype>
 #include <iostream>
 #include <iterator>
@@ -44,7 +45,7 @@ extern "C" {
 
 namespace hid_identify {
 
-std::vector<uint8_t> os_identity() {
+std::array<uint8_t, 4> os_identity() {
 	return {'W', 'I', 'N', '\0'};
 }
 
@@ -56,14 +57,14 @@ WindowsHIDDevice::WindowsHIDDevice(const std::wstring &filename)
 	if (!event_log_) {
 		auto error = ::GetLastError();
 		log(LogLevel::ERROR, LogCategory::OS_ERROR, LogMessage::DEV_OS_FUNC_ERROR_CODE_1,
-			2, ::gettext("%s: %s"), "RegisterEventSource", win32::hex_error(error).c_str());
+			LOG_FORMAT("%s: %s"), "RegisterEventSource", win32::hex_error(error).c_str());
 		throw OSError{};
 	}
 }
 
-void WindowsHIDDevice::open(USBDeviceInfo &device_info, std::vector<HIDReport> &reports) {
+Rejection WindowsHIDDevice::open(USBDeviceInfo &device_info, HIDReports &reports) {
 	if (handle_) {
-		return;
+		return Rejection::NONE;
 	}
 
 	::SetLastError(0);
@@ -73,16 +74,20 @@ void WindowsHIDDevice::open(USBDeviceInfo &device_info, std::vector<HIDReport> &
 		auto error = ::GetLastError();
 		if (error == ERROR_ACCESS_DENIED) {
 			log(LogLevel::WARNING, LogCategory::UNSUPPORTED_DEVICE, LogMessage::DEV_ACCESS_DENIED,
-				0, ::gettext("Access denied"));
+				LOG_FORMAT("Access denied"));
 		} else {
 			log(LogLevel::ERROR, LogCategory::IO_ERROR, LogMessage::DEV_OS_FUNC_ERROR_CODE_1,
-				2, ::gettext("%s: %s"), "CreateFile", win32::hex_error(error).c_str());
+				LOG_FORMAT("%s: %s"), "CreateFile", win32::hex_error(error).c_str());
 		}
 		throw UnavailableDevice{};
 	}
 
-	init_device_info(device_info);
-	init_reports(reports);
+	Rejection rejection = init_device_info(device_info);
+	if (rejection != Rejection::NONE) {
+		return rejection;
+	}
+
+	return init_reports(reports);
 }
 
 int16_t WindowsHIDDevice::interface_number() {
@@ -111,13 +116,13 @@ int16_t WindowsHIDDevice::interface_number() {
 	return std::stoi(std::wstring{{hi, lo}}, nullptr, 16);
 }
 
-void WindowsHIDDevice::init_device_info(USBDeviceInfo &device_info) {
+Rejection WindowsHIDDevice::init_device_info(USBDeviceInfo &device_info) {
 	HIDD_ATTRIBUTES attrs{};
 	attrs.Size = sizeof(HIDD_ATTRIBUTES);
 
 	if (!::HidD_GetAttributes(handle_.get(), &attrs)) {
 		log(LogLevel::ERROR, LogCategory::OS_ERROR, LogMessage::DEV_NO_HID_ATTRIBUTES,
-			0, ::gettext("Unable to get HID attributes"));
+			LOG_FORMAT("Unable to get HID attributes"));
 		throw OSError{};
 	}
 
@@ -126,12 +131,14 @@ void WindowsHIDDevice::init_device_info(USBDeviceInfo &device_info) {
 	// This should always be known
 	if (device_info.interface_number == -1) {
 		log(LogLevel::INFO, LogCategory::UNSUPPORTED_DEVICE, LogMessage::DEV_UNKNOWN_USB_INTERFACE_NUMBER,
-			0, ::gettext("Unknown USB interface number"));
-		throw DisallowedUSBDevice{};
+			LOG_FORMAT("Unknown USB interface number"));
+		return Rejection::DISALLOWED_USB_DEVICE;
 	}
+
+	return Rejection::NONE;
 }
 
-std::vector<HIDCollection> WindowsHIDDevice::caps_to_collections(
+Rejection WindowsHIDDevice::caps_to_collections(HIDReports &reports,
 		USAGE usage_page, HIDP_REPORT_TYPE report_type, USHORT len,
 		PHIDP_PREPARSED_DATA preparsed_data) {
 	std::vector<HIDP_VALUE_CAPS> vcaps(len);
@@ -139,46 +146,37 @@ std::vector<HIDCollection> WindowsHIDDevice::caps_to_collections(
 	NTSTATUS ret = ::HidP_GetSpecificValueCaps(report_type, usage_page,
 			0, 0, vcaps.data(), &len, preparsed_data);
 	if (ret == HIDP_STATUS_USAGE_NOT_FOUND) {
-		return {};
+		return Rejection::NONE;
 	} else if (ret != HIDP_STATUS_SUCCESS) {
 		log(LogLevel::ERROR, LogCategory::OS_ERROR, LogMessage::DEV_OS_FUNC_ERROR_PARAM_1_CODE_1,
-			3, ::gettext("%s(%s): %s"), "HidP_GetSpecificValueCaps",
-			std::to_string(report_type).c_str(),
+			LOG_FORMAT("%s(%s): %s"), "HidP_GetSpecificValueCaps",
+			static_cast<int>(report_type),
 			win32::hex_error(ret).c_str());
 		throw OSError{};
 	}
 
-	std::vector<HIDCollection> collections;
+	HIDReportType type = report_type == HidP_Input ? HIDReportType::INPUT
+		: (report_type == HidP_Output ? HIDReportType::OUTPUT : HIDReportType::FEATURE);
 
 	for (size_t i = 0; i < len; i++) {
-		HIDCollection collection{};
-
 		if (vcaps[i].IsRange) {
-			throw UnsupportedHIDReportDescriptor{};
+			return Rejection::UNSUPPORTED_HID_REPORT_DESCRIPTOR;
 		}
 
-		collection.has_usage = true;
-		collection.usage = vcaps[i].NotRange.Usage;
-
-		collection.has_minimum = true;
-		collection.minimum = vcaps[i].LogicalMin;
-
-		collection.has_maximum = true;
-		collection.maximum = vcaps[i].LogicalMax;
-
-		collection.has_count = true;
-		collection.count = vcaps[i].ReportCount;
-
-		collection.has_size = true;
-		collection.size = vcaps[i].BitSize;
-
-		collections.emplace_back(std::move(collection));
+		reports.add_item(type, {
+			HIDCollection::HAS_ALL,
+			vcaps[i].NotRange.Usage,
+			static_cast<uint32_t>(vcaps[i].LogicalMin),
+			static_cast<uint32_t>(vcaps[i].LogicalMax),
+			vcaps[i].ReportCount,
+			vcaps[i].BitSize,
+		});
 	}
 
-	return collections;
+	return Rejection::NONE;
 }
 
-void WindowsHIDDevice::init_reports(std::vector<HIDReport> &reports) {
+Rejection WindowsHIDDevice::init_reports(HIDReports &reports) {
 	::SetLastError(0);
 	auto preparsed_data = win32::wrap_output<PHIDP_PREPARSED_DATA, ::HidD_FreePreparsedData>(
 		[&] (PHIDP_PREPARSED_DATA &data) {
@@ -187,7 +185,7 @@ void WindowsHIDDevice::init_reports(std::vector<HIDReport> &reports) {
 	if (!preparsed_data) {
 		auto error = ::GetLastError();
 		log(LogLevel::ERROR, LogCategory::OS_ERROR, LogMessage::DEV_OS_FUNC_ERROR_CODE_1,
-			2, ::gettext("%s: %s"), "HidD_GetPreparsedData", win32::hex_error(error).c_str());
+			LOG_FORMAT("%s: %s"), "HidD_GetPreparsedData", win32::hex_error(error).c_str());
 		throw OSError{};
 	}
 
@@ -195,50 +193,53 @@ void WindowsHIDDevice::init_reports(std::vector<HIDReport> &reports) {
 	NTSTATUS ret = ::HidP_GetCaps(preparsed_data.get(), &caps);
 	if (ret != HIDP_STATUS_SUCCESS) {
 		log(LogLevel::ERROR, LogCategory::OS_ERROR, LogMessage::DEV_OS_FUNC_ERROR_CODE_1,
-			2, ::gettext("%s: %s"), "HidP_GetCaps", win32::hex_error(ret).c_str());
+			LOG_FORMAT("%s: %s"), "HidP_GetCaps", win32::hex_error(ret).c_str());
 		throw OSError{};
 	}
 
 	report_length_ = caps.OutputReportByteLength;
 
-	HIDReport report{};
+	reports.add_report();
+	reports.set_usage(caps.UsagePage, caps.Usage);
 
-	report.usage_page = caps.UsagePage;
-	report.usage = caps.Usage;
-
-	report.in = caps_to_collections(caps.UsagePage, HidP_Input,
+	Rejection rejection = caps_to_collections(reports, caps.UsagePage, HidP_Input,
 		caps.NumberInputValueCaps, preparsed_data.get());
-	report.out = caps_to_collections(caps.UsagePage, HidP_Output,
+	if (rejection != Rejection::NONE) {
+		return rejection;
+	}
+
+	rejection = caps_to_collections(reports, caps.UsagePage, HidP_Output,
 		caps.NumberOutputValueCaps, preparsed_data.get());
-	report.feature = caps_to_collections(caps.UsagePage, HidP_Feature,
-		caps.NumberFeatureValueCaps, preparsed_data.get());
+	if (rejection != Rejection::NONE) {
+		return rejection;
+	}
 
-	reports.emplace_back(std::move(report));
+	return caps_to_collections(reports, caps.UsagePage, HidP_Feature,
+		caps.NumberFeatureValueCaps, preparsed_data.get());
 }
 
 void WindowsHIDDevice::reset() noexcept {
 	handle_.reset();
 }
 
-void WindowsHIDDevice::log(LogLevel level, LogCategory category,
-		LogMessage message, int argc, const char *format...) noexcept {
-	std::va_list argv;
-	va_start(argv, format);
+void WindowsHIDDevice::log_message(LogLevel level, LogCategory category,
+		LogMessage message, const char *format, const LogArg *args,
+		size_t count) noexcept {
 	win32::vlog(event_log_.get(), static_cast<WORD>(level),
 		static_cast<WORD>(category), static_cast<DWORD>(message),
-		&filename_, argc, format, argv);
-	va_end(argv);
+		&filename_, format, args, count);
 }
 
-void WindowsHIDDevice::send_report(std::vector<uint8_t> &data) {
+void WindowsHIDDevice::send_report(const uint8_t *report, size_t length) {
 	// Minimum length is OutputReportByteLength (which includes the Report ID)
-	if (report_length_ < data.size()) {
+	if (report_length_ < length) {
 		log(LogLevel::ERROR, LogCategory::IO_ERROR, LogMessage::DEV_REPORT_LENGTH_TOO_SMALL,
-			2, ::gettext("Report length too small for message (%s < %s)"),
-			std::to_string(report_length_).c_str(), std::to_string(data.size()).c_str());
+			LOG_FORMAT("Report length too small for message (%s < %s)"),
+			report_length_, length);
 		throw IOLengthError{};
 	}
 
+	std::vector<uint8_t> data(report, report + length);
 	data.resize(report_length_);
 
 	::SetLastError(0);
@@ -246,7 +247,7 @@ void WindowsHIDDevice::send_report(std::vector<uint8_t> &data) {
 	if (!event) {
 		auto error = ::GetLastError();
 		log(LogLevel::ERROR, LogCategory::IO_ERROR, LogMessage::DEV_OS_FUNC_ERROR_CODE_1,
-			2, ::gettext("%s: %s"), "CreateEvent", win32::hex_error(error).c_str());
+			LOG_FORMAT("%s: %s"), "CreateEvent", win32::hex_error(error).c_str());
 		throw OSError{};
 	}
 
@@ -259,7 +260,7 @@ void WindowsHIDDevice::send_report(std::vector<uint8_t> &data) {
 		auto error = ::GetLastError();
 		if (error != ERROR_IO_PENDING) {
 			log(LogLevel::ERROR, LogCategory::IO_ERROR, LogMessage::DEV_WRITE_FAILED,
-				1, ::gettext("WriteFile: %s"), win32::hex_error(error).c_str());
+				LOG_FORMAT("WriteFile: %s"), win32::hex_error(error).c_str());
 			throw OSError{};
 		}
 	}
@@ -268,11 +269,11 @@ void WindowsHIDDevice::send_report(std::vector<uint8_t> &data) {
 	DWORD res = ::WaitForSingleObject(event.get(), 1000);
 	if (res == WAIT_TIMEOUT) {
 		log(LogLevel::ERROR, LogCategory::IO_ERROR, LogMessage::DEV_WRITE_TIMEOUT,
-			0, ::gettext("Report send timed out"));
+			LOG_FORMAT("Report send timed out"));
 	} else if (res != WAIT_OBJECT_0) {
 		auto error = ::GetLastError();
 		log(LogLevel::ERROR, LogCategory::IO_ERROR, LogMessage::DEV_OS_FUNC_ERROR_CODE_2,
-			3, ::gettext("%s: %s, %s"), "WaitForSingleObject", std::to_string(res).c_str(), win32::hex_error(error).c_str());
+			LOG_FORMAT("%s: %s, %s"), "WaitForSingleObject", res, win32::hex_error(error).c_str());
 	}
 
 	if (res != WAIT_OBJECT_0) {
@@ -284,14 +285,14 @@ void WindowsHIDDevice::send_report(std::vector<uint8_t> &data) {
 	if (::GetOverlappedResult(handle_.get(), &overlapped, &written, true)) {
 		if (written != data.size()) {
 			log(LogLevel::ERROR, LogCategory::IO_ERROR, LogMessage::DEV_SHORT_WRITE,
-				2, ::gettext("Write completed with only %s of %s bytes written"),
-				std::to_string(written).c_str(), std::to_string(data.size()).c_str());
+				LOG_FORMAT("Write completed with only %s of %s bytes written"),
+				written, data.size());
 			throw IOError{};
 		}
 	} else {
 		auto error = ::GetLastError();
 		log(LogLevel::ERROR, LogCategory::IO_ERROR, LogMessage::DEV_OS_FUNC_ERROR_CODE_1,
-			2, ::gettext("%s: %s"), "GetOverlappedResult", win32::hex_error(error).c_str());
+			LOG_FORMAT("%s: %s"), "GetOverlappedResult", win32::hex_error(error).c_str());
 		throw IOError{};
 	}
 }
@@ -1,6 +1,6 @@
 /*
 	qmk-hid-identify - Identify the current OS to QMK device
-	Copyright 2021  Simon Arlott
+	Copyright 2021,2026  Simon Arlott
 
 	This program is free software: you can redistribute it and/or modify
 	it under the terms of the GNU General Public License as published by
@@ -28,6 +28,7 @@ extern "C" {
 #	undef ERROR
 #endif
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <vector>
@@ -45,20 +46,20 @@ public:
 	explicit WindowsHIDDevice(const std::wstring &filename);
 
 protected:
-	void log(LogLevel level, LogCategory category, LogMessage message,
-		int argc, const char *format...) noexcept override;
+	void log_message(LogLevel level, LogCategory category, LogMessage message,
+		const char *format, const LogArg *args, size_t count) noexcept override;
 
-	void open(USBDeviceInfo &device_info, std::vector<HIDReport> &reports) override;
-	void send_report(std::vector<uint8_t> &data) override;
+	Rejection open(USBDeviceInfo &device_info, HIDReports &reports) override;
+	void send_report(const uint8_t *report, size_t length) override;
 	void reset() noexcept override;
 
 private:
 	int16_t interface_number();
-	void init_device_info(USBDeviceInfo &device_info);
-	std::vector<HIDCollection> caps_to_collections(
+	Rejection init_device_info(USBDeviceInfo &device_info);
+	Rejection caps_to_collections(HIDReports &reports,
 		USAGE usage_page, HIDP_REPORT_TYPE report_type, USHORT len,
 		PHIDP_PREPARSED_DATA preparsed_data);
-	void init_reports(std::vector<HIDReport> &reports);
+	Rejection init_reports(HIDReports &reports);
 
 	const std::wstring filename_;
 	win32::wrapped_ptr<HANDLE, ::DeregisterEventSource> event_log_;
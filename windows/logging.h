@@ -1,6 +1,6 @@
 /*
 	qmk-hid-identify - Identify the current OS to QMK device
-	Copyright 2021  Simon Arlott
+	Copyright 2021,2026  Simon Arlott
 
 	This program is free software: you can redistribute it and/or modify
 	it under the terms of the GNU General Public License as published by
@@ -23,10 +23,9 @@
 #	undef ERROR
 #endif
 
+#include <cstdint>
 #include <vector>
 
-static inline const char *gettext(const char *msgid) { return msgid; }
-
 #define LOGGING_HAS_LEVEL_IDS
 
 #define LOGGING_LEVEL_ERROR_ID EVENTLOG_ERROR_TYPE
@@ -38,3 +37,14 @@ static inline const char *gettext(const char *msgid) { return msgid; }
 #define LOGGING_HAS_MESSAGE_IDS
 
 #include "events.h"
+
+namespace hid_identify {
+
+enum class LogMessage : unsigned int;
+
+/* Only messages in the event log are translated (by events.mc) */
+inline const char *log_translate(LogMessage, uint32_t, const char *format) noexcept {
+	return format;
+}
+
+} // namespace hid_identify
@@ -1,6 +1,6 @@
 /*
 	qmk-hid-identify - Identify the current OS to QMK device
-	Copyright 2021,2024  Simon Arlott
+	Copyright 2021,2024,2026  Simon Arlott
 
 	This program is free software: you can redistribute it and/or modify
 	it under the terms of the GNU General Public License as published by
@@ -107,7 +107,9 @@ static int command_report() {
 
 	for (const auto& device : WindowsHIDEnumeration()) {
 		try {
-			WindowsHIDDevice(device).identify();
+			if (WindowsHIDDevice(device).identify() != Rejection::NONE) {
+				exit_ret = exit_ret ? exit_ret : 1;
+			}
 		} catch (const Exception&) {
 			exit_ret = exit_ret ? exit_ret : 1;
 		} catch (const std::exception &e) {
@@ -1,6 +1,6 @@
 /*
 	qmk-hid-identify - Identify the current OS to QMK device
-	Copyright 2021-2022,2024  Simon Arlott
+	Copyright 2021-2022,2024,2026  Simon Arlott
 
 	This program is free software: you can redistribute it and/or modify
 	it under the terms of the GNU General Public License as published by
@@ -36,7 +36,6 @@ extern "C" {
 #include "windows++.h"
 
 #include <array>
-#include <cstdarg>
 #include <iostream>
 #include <vector>
 
@@ -63,7 +62,7 @@ int command_service() {
 		win32::log(event_log.get(), EVENTLOG_ERROR_TYPE,
 			LOGGING_CATEGORY_SERVICE_ID,
 			LOGGING_MESSAGE_SVC_OS_FUNC_ERROR_CODE_1_ID,
-			2, ::gettext("%s: %s"), "StartServiceCtrlDispatcher", win32::hex_error(error).c_str());
+			LOG_FORMAT("%s: %s"), "StartServiceCtrlDispatcher", win32::hex_error(error).c_str());
 		throw OSError{};
 	}
 
@@ -77,7 +76,7 @@ WindowsHIDService::WindowsHIDService() {
 	if (!event_log_) {
 		auto error = ::GetLastError();
 		log(LogLevel::ERROR, LogCategory::OS_ERROR, LogMessage::SVC_OS_FUNC_ERROR_CODE_1,
-			2, ::gettext("%s: %s"), "RegisterEventSource", win32::hex_error(error).c_str());
+			LOG_FORMAT("%s: %s"), "RegisterEventSource", win32::hex_error(error).c_str());
 		throw OSError{};
 	}
 }
@@ -102,7 +101,7 @@ void WindowsHIDService::main() {
 	if (status_ == 0) {
 		auto error = ::GetLastError();
 		log(LogLevel::ERROR, LogCategory::OS_ERROR, LogMessage::SVC_OS_FUNC_ERROR_CODE_1,
-			2, ::gettext("%s: %s"), "RegisterServiceCtrlHandlerEx", win32::hex_error(error).c_str());
+			LOG_FORMAT("%s: %s"), "RegisterServiceCtrlHandlerEx", win32::hex_error(error).c_str());
 		throw OSError{};
 	}
 
@@ -203,7 +202,7 @@ DWORD WindowsHIDService::queue_all_devices() {
 		auto lock = win32::acquire_mutex(devices_mutex_.get());
 		if (!lock) {
 			log(LogLevel::ERROR, LogCategory::OS_ERROR, LogMessage::SVC_MAIN_MUTEX_FAILURE,
-				0, ::gettext("Service main thread failed to acquire device queue mutex"));
+				LOG_FORMAT("Service main thread failed to acquire device queue mutex"));
 			return ERROR_SERVICE_SPECIFIC_ERROR;
 		}
 		devices_.emplace_back(std::move(device));
@@ -253,7 +252,7 @@ DWORD WindowsHIDService::report_one_device() {
 	auto lock = win32::acquire_mutex(devices_mutex_.get());
 	if (!lock) {
 		log(LogLevel::ERROR, LogCategory::OS_ERROR, LogMessage::SVC_MAIN_MUTEX_FAILURE,
-			0, ::gettext("Service main thread failed to acquire device queue mutex"));
+			LOG_FORMAT("Service main thread failed to acquire device queue mutex"));
 		return ERROR_SERVICE_SPECIFIC_ERROR;
 	}
 
@@ -268,7 +267,8 @@ DWORD WindowsHIDService::report_one_device() {
 		lock.reset();
 
 		try {
-			WindowsHIDDevice(device).identify();
+			/* Devices that are rejected are ignored */
+			(void)WindowsHIDDevice(device).identify();
 		} catch (const Exception&) {
 			// ignored
 		}
@@ -300,7 +300,7 @@ DWORD WindowsHIDService::control(DWORD code, DWORD ev_type, LPVOID ev_data) {
 		case SERVICE_CONTROL_POWEREVENT:
 			if (ev_type == PBT_APMRESUMEAUTOMATIC) {
 				log(LogLevel::INFO, LogCategory::SERVICE, LogMessage::SVC_POWER_RESUME,
-					0, ::gettext("Power resumed"));
+					LOG_FORMAT("Power resumed"));
 				::SetEvent(power_resume_event_.get());
 			}
 			return NO_ERROR;
@@ -322,7 +322,7 @@ void WindowsHIDService::device_arrival(DEV_BROADCAST_DEVICEINTERFACE *dev) {
 	auto lock = win32::acquire_mutex(devices_mutex_.get());
 	if (!lock) {
 		log(LogLevel::ERROR, LogCategory::OS_ERROR, LogMessage::SVC_CTRL_MUTEX_FAILURE,
-			0, ::gettext("Service control handler failed to acquire device queue mutex"));
+			LOG_FORMAT("Service control handler failed to acquire device queue mutex"));
 		control(SERVICE_CONTROL_STOP, 0, 0);
 		return;
 	}
@@ -350,10 +350,10 @@ void WindowsHIDService::report_status(DWORD state, DWORD exit_code,
 void WindowsHIDService::status_ok(DWORD state) {
 	if (state == SERVICE_RUNNING) {
 		log(LogLevel::INFO, LogCategory::SERVICE, LogMessage::SVC_STARTED,
-			0, ::gettext("Service started"));
+			LOG_FORMAT("Service started"));
 	} else if (state == SERVICE_STOPPED) {
 		log(LogLevel::INFO, LogCategory::SERVICE, LogMessage::SVC_STOPPED,
-			0, ::gettext("Service stopped"));
+			LOG_FORMAT("Service stopped"));
 	}
 	report_status(state, NO_ERROR, 0, 0, 0);
 }
@@ -362,39 +362,37 @@ void WindowsHIDService::status_pending(DWORD state, DWORD wait_hint_ms,
 		DWORD check_point) {
 	if (state == SERVICE_START_PENDING) {
 		log(LogLevel::INFO, LogCategory::SERVICE, LogMessage::SVC_STARTING,
-			0, ::gettext("Service starting"));
+			LOG_FORMAT("Service starting"));
 	} else if (state == SERVICE_STOP_PENDING) {
 		log(LogLevel::INFO, LogCategory::SERVICE, LogMessage::SVC_STOPPING,
-			0, ::gettext("Service stopping"));
+			LOG_FORMAT("Service stopping"));
 	}
 	report_status(state, NO_ERROR, 0, wait_hint_ms, check_point);
 }
 
 void WindowsHIDService::status_error(DWORD exit_code, DWORD service_exit_code) {
 	log(LogLevel::ERROR, LogCategory::SERVICE, LogMessage::SVC_FAILED,
-		0, ::gettext("Service failed"));
+		LOG_FORMAT("Service failed"));
 	report_status(SERVICE_STOPPED, exit_code, service_exit_code, 0, 0);
 }
 
-void WindowsHIDService::log(LogLevel level, LogCategory category,
-		LogMessage message, int argc, const char *format...) noexcept {
-	std::va_list argv;
-	va_start(argv, format);
+void WindowsHIDService::log_message(LogLevel level, LogCategory category,
+		LogMessage message, const char *format, const LogArg *args,
+		size_t count) noexcept {
 	win32::vlog(event_log_.get(), static_cast<WORD>(level),
 		static_cast<WORD>(category), static_cast<DWORD>(message),
-		nullptr, argc, format, argv, false);
-	va_end(argv);
+		nullptr, format, args, count, false);
 }
 
 void WindowsHIDService::log(const win32::Exception1 &e) noexcept {
 	log(LogLevel::ERROR, LogCategory::OS_ERROR, LogMessage::SVC_OS_FUNC_ERROR_CODE_1,
-		2, ::gettext("%s: %s"), e.function_name().c_str(),
+		LOG_FORMAT("%s: %s"), e.function_name().c_str(),
 		win32::hex_error(e.error()).c_str());
 }
 
 void WindowsHIDService::log(const win32::Exception2 &e) noexcept {
 	log(LogLevel::ERROR, LogCategory::OS_ERROR, LogMessage::SVC_OS_FUNC_ERROR_CODE_2,
-		3, ::gettext("%s: %s, %s"), e.function_name().c_str(),
+		LOG_FORMAT("%s: %s, %s"), e.function_name().c_str(),
 		win32::hex_error(e.return_code()).c_str(),
 		win32::hex_error(e.error()).c_str());
 }
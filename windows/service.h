@@ -1,6 +1,6 @@
 /*
 	qmk-hid-identify - Identify the current OS to QMK device
-	Copyright 2021-2022  Simon Arlott
+	Copyright 2021-2022,2026  Simon Arlott
 
 	This program is free software: you can redistribute it and/or modify
 	it under the terms of the GNU General Public License as published by
@@ -26,6 +26,8 @@
 
 #include <deque>
 
+#include "../common/log-filter.h"
+#include "../common/log-format.h"
 #include "../common/types.h"
 #include "windows++.h"
 
@@ -60,8 +62,17 @@ private:
 		DWORD check_point = 0);
 	void status_error(DWORD exit_code, DWORD service_exit_code = 0);
 
+	template <class Format, class... Args>
 	void log(LogLevel level, LogCategory category, LogMessage message,
-		int argc, const char *format...) noexcept;
+			Format format, const Args&... args) noexcept {
+		if (log_enabled(level, category)) {
+			LogArgs values{format, args...};
+			log_message(level, category, message, values.format(message), values.data(), values.size());
+		}
+	}
+
+	void log_message(LogLevel level, LogCategory category, LogMessage message,
+		const char *format, const LogArg *args, size_t count) noexcept;
 	void log(const win32::Exception1 &e) noexcept;
 	void log(const win32::Exception2 &e) noexcept;
 
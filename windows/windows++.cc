@@ -1,6 +1,6 @@
 /*
 	qmk-hid-identify - Identify the current OS to QMK device
-	Copyright 2021  Simon Arlott
+	Copyright 2021,2026  Simon Arlott
 
 	This program is free software: you can redistribute it and/or modify
 	it under the terms of the GNU General Public License as published by
@@ -23,8 +23,9 @@
 #	undef ERROR
 #endif
 
-#include <cstdio>
 #include <cstdarg>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -95,34 +96,25 @@ std::string hex_error(DWORD error) noexcept {
 	return {text.data()};
 }
 
-void log(HANDLE event_source, WORD type, WORD category, DWORD id,
-		int argc, const char *format...) noexcept {
-	std::va_list argv;
-	va_start(argv, format);
-	vlog(event_source, type, category, id, nullptr, argc, format, argv);
-	va_end(argv);
-}
-
 void vlog(HANDLE event_source, WORD type, WORD category, DWORD id,
-		const std::wstring *prefix, int argc, const char *format,
-		std::va_list argv, bool console) noexcept {
-	std::va_list args_fallback;
-	va_copy(args_fallback, argv);
-
-	int prefix_count = (prefix != nullptr) ? 1 : 0;
+		const std::wstring *prefix, const char *format,
+		const hid_identify::LogArg *args, size_t count,
+		bool console) noexcept {
+	size_t prefix_count = (prefix != nullptr) ? 1 : 0;
 	std::vector<std::vector<wchar_t>> ev_strings;
-	std::vector<const wchar_t*> ev_string_ptrs(prefix_count + argc);
+	std::vector<const wchar_t*> ev_string_ptrs(prefix_count + count);
 
-	ev_strings.reserve(prefix_count + argc);
+	ev_strings.reserve(prefix_count + count);
 	if (prefix != nullptr) {
 		ev_strings.emplace_back(prefix->c_str(), prefix->c_str() + prefix->length() + 1);
 		ev_string_ptrs[0] = ev_strings.back().data();
 	}
 
-	for (int i = 0; i < argc; i++) {
-		auto value = std::string{va_arg(argv, char*)};
+	for (size_t i = 0; i < count; i++) {
+		hid_identify::LogArg::Buffer buf;
+		const char *value = args[i].text(buf);
 
-		ev_strings.emplace_back(value.c_str(), value.c_str() + value.length() + 1);
+		ev_strings.emplace_back(value, value + std::strlen(value) + 1);
 		ev_string_ptrs[prefix_count + i] = ev_strings.back().data();
 	}
 
@@ -149,10 +141,7 @@ void vlog(HANDLE event_source, WORD type, WORD category, DWORD id,
 		} else {
 			std::vector<char> text(win32::max_path + 1024);
 
-			if (std::vsnprintf(text.data(), text.size(), format, args_fallback) < 0) {
-				text[0] = '?';
-				text[1] = '\0';
-			}
+			hid_identify::log_format(text.data(), text.size(), format, args, count);
 
 			if (prefix != nullptr) {
 				out << *prefix << ": ";
@@ -160,7 +149,6 @@ void vlog(HANDLE event_source, WORD type, WORD category, DWORD id,
 			out << text.data() << std::endl;
 		}
 	}
-	::va_end(args_fallback);
 }
 
 std::wstring current_process_filename() {
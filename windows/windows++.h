@@ -1,6 +1,6 @@
 /*
 	qmk-hid-identify - Identify the current OS to QMK device
-	Copyright 2021,2024  Simon Arlott
+	Copyright 2021,2024,2026  Simon Arlott
 
 	This program is free software: you can redistribute it and/or modify
 	it under the terms of the GNU General Public License as published by
@@ -23,7 +23,7 @@
 #	undef ERROR
 #endif
 
-#include <cstdarg>
+#include <cstddef>
 #include <exception>
 #include <functional>
 #include <memory>
@@ -32,6 +32,8 @@
 #include <utility>
 #include <vector>
 
+#include "../common/log-format.h"
+
 namespace win32 {
 
 constexpr DWORD max_path = 32767;
@@ -199,12 +201,20 @@ inline bool isxdigit(wchar_t ch) {
 
 std::string hex_error(DWORD error) noexcept;
 
+void vlog(HANDLE event_source, WORD type, WORD category, DWORD id,
+		const std::wstring *prefix, const char *format,
+		const hid_identify::LogArg *args, size_t count,
+		bool console = true) noexcept;
+
+template <class Format, class... Args>
 void log(HANDLE event_source, WORD type, WORD category, DWORD id,
-	int argc, const char *format...) noexcept;
+		Format format, const Args&... args) noexcept {
+	hid_identify::LogArgs values{format, args...};
 
-void vlog(HANDLE event_source, WORD type, WORD category, DWORD id,
-		const std::wstring *prefix, int argc, const char *format,
-		std::va_list argv, bool console = true) noexcept;
+	vlog(event_source, type, category, id, nullptr,
+		values.format(static_cast<hid_identify::LogMessage>(id)),
+		values.data(), values.size());
+}
 
 std::wstring current_process_filename();
 bool is_elevated();